@@ -8,3 +8,7 @@ void gameInit() {
     tickF_add(wolf3dTick);
     renderF_add(wolf3dRender);
 }
+
+void gameShutdown() {
+    wolf3dShutdown();
+}
@@ -1,4 +1,5 @@
 #ifndef EGAME_GAME_H
 #define EGAME_GAME_H
 void gameInit();
+void gameShutdown();
 #endif
@@ -0,0 +1,193 @@
+#include "hiz3d.h"
+#include <math.h>
+#include <stdlib.h>
+
+static Render3DView gView;
+static float *gDepth = NULL;  // all levels back to back, view depth
+static int gCapacity = 0;
+static int gLevelCount = 0;
+static int gLevelW[HIZ3D_MAX_LEVELS], gLevelH[HIZ3D_MAX_LEVELS];
+static int gLevelOffset[HIZ3D_MAX_LEVELS];
+static int gDirty = 0;   // levels above 0 are stale
+static int gEmpty = 1;   // nothing rasterized this frame
+
+void hiz3dBegin(const Render3DView *vw) {
+    gView = *vw;
+    gLevelCount = 0;
+    gEmpty = 1;
+    gDirty = 0;
+
+    int w = ((int)vw->width + HIZ3D_CELL - 1) / HIZ3D_CELL;
+    int h = ((int)vw->height + HIZ3D_CELL - 1) / HIZ3D_CELL;
+    if (w <= 0 || h <= 0) return;
+
+    int total = 0;
+    while (gLevelCount < HIZ3D_MAX_LEVELS) {
+        gLevelW[gLevelCount] = w;
+        gLevelH[gLevelCount] = h;
+        gLevelOffset[gLevelCount] = total;
+        total += w * h;
+        gLevelCount++;
+        if (w == 1 && h == 1) break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+
+    if (total > gCapacity) {
+        float *grown = realloc(gDepth, (size_t)total * sizeof(float));
+        if (!grown) { gLevelCount = 0; return; }
+        gDepth = grown;
+        gCapacity = total;
+    }
+    for (int i = 0; i < gLevelW[0] * gLevelH[0]; i++) gDepth[i] = INFINITY;
+}
+
+// Screen position in cells and view depth; 0 when behind the near plane.
+static int projectPoint(Vec3 p, float *x, float *y, float *z) {
+    const Render3DView *vw = &gView;
+    const float *rx = vw->viewProj.m[0], *ry = vw->viewProj.m[1], *rw = vw->viewProj.m[2];
+    float w = rw[0] * p.x + rw[1] * p.y + rw[2] * p.z + rw[3];
+    if (w < vw->nearPlane) return 0;
+    float cx = rx[0] * p.x + rx[1] * p.y + rx[2] * p.z + rx[3];
+    float cy = ry[0] * p.x + ry[1] * p.y + ry[2] * p.z + ry[3];
+    *x = (cx / w * 0.5f + 0.5f) * vw->width / (float)HIZ3D_CELL;
+    *y = (1.0f - (cy / w * 0.5f + 0.5f)) * vw->height / (float)HIZ3D_CELL;
+    *z = w;
+    return 1;
+}
+
+static void rasterOccluder(const float x[3], const float y[3], const float z[3], Render3DCullMode cullMode) {
+    // Same winding rule as drawMesh: faces it would cull don't occlude.
+    double area = ((double)x[1] - x[0]) * ((double)y[2] - y[0]) - ((double)y[1] - y[0]) * ((double)x[2] - x[0]);
+    if (area == 0.0) return;
+    if (cullMode == RENDER3D_CULL_BACK && area < 0.0) return;
+    if (cullMode == RENDER3D_CULL_FRONT && area > 0.0) return;
+    double sign = area > 0.0 ? 1.0 : -1.0;
+
+    // Edge i (opposite vertex i) as a*x + b*y + c >= 0 inside.
+    double ea[3], eb[3], ec[3];
+    for (int i = 0; i < 3; i++) {
+        int p = (i + 1) % 3, q = (i + 2) % 3;
+        ea[i] = ((double)y[p] - y[q]) * sign;
+        eb[i] = ((double)x[q] - x[p]) * sign;
+        ec[i] = -(ea[i] * x[p] + eb[i] * y[p]);
+    }
+    // 1/z is linear in screen space; its smallest value over a cell's
+    // corners is the farthest the triangle gets inside the cell.
+    double invArea = 1.0 / (area * sign);
+    double pa = 0.0, pb = 0.0, pc = 0.0;
+    for (int i = 0; i < 3; i++) {
+        double w = 1.0 / z[i];
+        pa += w * ea[i] * invArea;
+        pb += w * eb[i] * invArea;
+        pc += w * ec[i] * invArea;
+    }
+
+    int w0 = gLevelW[0], h0 = gLevelH[0];
+    int minX = (int)floorf(fminf(x[0], fminf(x[1], x[2])));
+    int maxX = (int)ceilf(fmaxf(x[0], fmaxf(x[1], x[2]))) - 1;
+    int minY = (int)floorf(fminf(y[0], fminf(y[1], y[2])));
+    int maxY = (int)ceilf(fmaxf(y[0], fmaxf(y[1], y[2]))) - 1;
+    if (minX < 0) minX = 0;
+    if (minY < 0) minY = 0;
+    if (maxX > w0 - 1) maxX = w0 - 1;
+    if (maxY > h0 - 1) maxY = h0 - 1;
+
+    for (int cy = minY; cy <= maxY; cy++) {
+        for (int cx = minX; cx <= maxX; cx++) {
+            int covered = 1;
+            double minW = INFINITY;
+            for (int k = 0; k < 4 && covered; k++) {
+                double px = cx + (k & 1), py = cy + (k >> 1);
+                for (int i = 0; i < 3; i++) {
+                    if (ea[i] * px + eb[i] * py + ec[i] < 0.0) covered = 0;
+                }
+                double w = pa * px + pb * py + pc;
+                if (w < minW) minW = w;
+            }
+            if (!covered || !(minW > 0.0)) continue;
+
+            float depth = (float)(1.0 / minW);
+            float *cell = &gDepth[cy * w0 + cx];
+            if (depth < *cell) *cell = depth;
+            gEmpty = 0;
+            gDirty = 1;
+        }
+    }
+}
+
+void hiz3dAddMesh(const Mesh *mesh, const Mat34 *world) {
+    if (gLevelCount == 0 || !mesh || !mesh->verts) return;
+
+    // Triangles crossing the near plane are skipped rather than clipped;
+    // dropping an occluder only costs culling, never correctness.
+    for (int i = 0; i + 2 < mesh->indexCount; i += 3) {
+        float x[3], y[3], z[3];
+        int ok = 1;
+        for (int j = 0; j < 3 && ok; j++) {
+            int idx = mesh->indices ? mesh->indices[i + j] : i + j;
+            if (idx < 0 || idx >= mesh->vertCount) { ok = 0; break; }
+            ok = projectPoint(render3dMat34Apply(world, mesh->verts[idx]), &x[j], &y[j], &z[j]);
+        }
+        if (ok) rasterOccluder(x, y, z, mesh->cullMode);
+    }
+}
+
+static void buildLevels(void) {
+    for (int l = 1; l < gLevelCount; l++) {
+        const float *src = gDepth + gLevelOffset[l - 1];
+        float *dst = gDepth + gLevelOffset[l];
+        int sw = gLevelW[l - 1], sh = gLevelH[l - 1];
+        for (int y = 0; y < gLevelH[l]; y++) {
+            for (int x = 0; x < gLevelW[l]; x++) {
+                int x0 = x * 2, y0 = y * 2;
+                int x1 = x0 + 1 < sw ? x0 + 1 : x0;
+                int y1 = y0 + 1 < sh ? y0 + 1 : y0;
+                float d = fmaxf(fmaxf(src[y0 * sw + x0], src[y0 * sw + x1]),
+                                fmaxf(src[y1 * sw + x0], src[y1 * sw + x1]));
+                dst[y * gLevelW[l] + x] = d;
+            }
+        }
+    }
+    gDirty = 0;
+}
+
+int hiz3dOccludedAABB(Vec3 min, Vec3 max) {
+    if (gLevelCount == 0 || gEmpty) return 0;
+    if (gDirty) buildLevels();
+
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    float nearest = INFINITY;
+    for (int k = 0; k < 8; k++) {
+        Vec3 p = v3(k & 1 ? max.x : min.x, k & 2 ? max.y : min.y, k & 4 ? max.z : min.z);
+        float x, y, z;
+        // A box reaching behind the near plane can't be bounded on screen.
+        if (!projectPoint(p, &x, &y, &z)) return 0;
+        minX = fminf(minX, x); maxX = fmaxf(maxX, x);
+        minY = fminf(minY, y); maxY = fmaxf(maxY, y);
+        nearest = fminf(nearest, z);
+    }
+
+    int x0 = (int)floorf(minX), x1 = (int)floorf(maxX);
+    int y0 = (int)floorf(minY), y1 = (int)floorf(maxY);
+    if (x1 < 0 || y1 < 0 || x0 >= gLevelW[0] || y0 >= gLevelH[0]) return 0;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > gLevelW[0] - 1) x1 = gLevelW[0] - 1;
+    if (y1 > gLevelH[0] - 1) y1 = gLevelH[0] - 1;
+
+    int level = 0;
+    while (level + 1 < gLevelCount && (x1 - x0 > 1 || y1 - y0 > 1)) {
+        x0 >>= 1; x1 >>= 1;
+        y0 >>= 1; y1 >>= 1;
+        level++;
+    }
+
+    const float *depth = gDepth + gLevelOffset[level];
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            if (depth[y * gLevelW[level] + x] >= nearest) return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,21 @@
+#ifndef HIZ3D_H
+#define HIZ3D_H
+
+#include "render3d.h"
+
+// Low-resolution hierarchical depth buffer for occlusion culling. Level 0
+// has one cell per HIZ3D_CELL x HIZ3D_CELL pixels; occluder triangles only
+// write cells they cover completely, at their farthest depth inside the
+// cell. Each further level keeps the farthest depth of a 2x2 block, so a
+// box test reads at most 2x2 cells of the level matching its size.
+#define HIZ3D_CELL 4
+#define HIZ3D_MAX_LEVELS 12
+
+// Clears the buffer for a new view.
+void hiz3dBegin(const Render3DView *vw);
+// Rasterizes a mesh as an occluder; world may be NULL for world-space meshes.
+void hiz3dAddMesh(const Mesh *mesh, const Mat34 *world);
+// 1 when the world-space box is certainly behind the occluders so far.
+int hiz3dOccludedAABB(Vec3 min, Vec3 max);
+
+#endif
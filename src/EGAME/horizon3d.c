@@ -0,0 +1,124 @@
+#include "horizon3d.h"
+#include <math.h>
+#include <stdlib.h>
+
+static Render3DView gView;
+static float *gTop = NULL;    // per column: highest covered screen y
+static float *gDepth = NULL;  // per column: farthest depth that raised it
+static int gCapacity = 0;
+static int gWidth = 0;
+static int gEmpty = 1;        // horizon still at the screen bottom
+
+void horizon3dBegin(const Render3DView *vw) {
+    gView = *vw;
+    gEmpty = 1;
+    gWidth = (int)vw->width;
+    if (gWidth <= 0) { gWidth = 0; return; }
+
+    if (gWidth > gCapacity) {
+        float *top = realloc(gTop, (size_t)gWidth * sizeof(float));
+        if (top) gTop = top;
+        float *depth = realloc(gDepth, (size_t)gWidth * sizeof(float));
+        if (depth) gDepth = depth;
+        if (!top || !depth) { gWidth = 0; return; }
+        gCapacity = gWidth;
+    }
+    for (int x = 0; x < gWidth; x++) {
+        gTop[x] = vw->height;
+        gDepth[x] = 0.0f;
+    }
+}
+
+// Screen position in pixels and view depth; 0 when behind the near plane.
+static int projectPoint(Vec3 p, float *x, float *y, float *z) {
+    const Render3DView *vw = &gView;
+    const float *rx = vw->viewProj.m[0], *ry = vw->viewProj.m[1], *rw = vw->viewProj.m[2];
+    float w = rw[0] * p.x + rw[1] * p.y + rw[2] * p.z + rw[3];
+    if (w < vw->nearPlane) return 0;
+    float cx = rx[0] * p.x + rx[1] * p.y + rx[2] * p.z + rx[3];
+    float cy = ry[0] * p.x + ry[1] * p.y + ry[2] * p.z + ry[3];
+    *x = (cx / w * 0.5f + 0.5f) * vw->width;
+    *y = (1.0f - (cy / w * 0.5f + 0.5f)) * vw->height;
+    *z = w;
+    return 1;
+}
+
+static void raiseHorizon(const float x[3], const float y[3], const float z[3], Render3DCullMode cullMode) {
+    // Same winding rule as drawMesh: faces it would cull don't occlude.
+    double area = ((double)x[1] - x[0]) * ((double)y[2] - y[0]) - ((double)y[1] - y[0]) * ((double)x[2] - x[0]);
+    if (area == 0.0) return;
+    if (cullMode == RENDER3D_CULL_BACK && area < 0.0) return;
+    if (cullMode == RENDER3D_CULL_FRONT && area > 0.0) return;
+
+    // The farthest vertex stands in for the depth of any point on it.
+    float depth = fmaxf(z[0], fmaxf(z[1], z[2]));
+    float minX = fminf(x[0], fminf(x[1], x[2]));
+    float maxX = fmaxf(x[0], fmaxf(x[1], x[2]));
+    int c0 = (int)ceilf(minX - 0.5f), c1 = (int)floorf(maxX - 0.5f);
+    if (c0 < 0) c0 = 0;
+    if (c1 > gWidth - 1) c1 = gWidth - 1;
+
+    // Top of the triangle at each column center is where its highest edge
+    // crosses it.
+    for (int c = c0; c <= c1; c++) {
+        float cx = (float)c + 0.5f;
+        float top = INFINITY;
+        for (int i = 0; i < 3; i++) {
+            int j = (i + 1) % 3;
+            float xa = x[i], xb = x[j];
+            if (cx < fminf(xa, xb) || cx > fmaxf(xa, xb)) continue;
+            float ey = xa == xb ? fminf(y[i], y[j]) : y[i] + (cx - xa) * (y[j] - y[i]) / (xb - xa);
+            if (ey < top) top = ey;
+        }
+        if (top < gTop[c]) {
+            gTop[c] = top;
+            if (depth > gDepth[c]) gDepth[c] = depth;
+            gEmpty = 0;
+        }
+    }
+}
+
+void horizon3dAddMesh(const Mesh *mesh, const Mat34 *world) {
+    if (gWidth == 0 || !mesh || !mesh->verts) return;
+
+    // Triangles crossing the near plane are skipped; a lower horizon only
+    // costs culling, never correctness.
+    for (int i = 0; i + 2 < mesh->indexCount; i += 3) {
+        float x[3], y[3], z[3];
+        int ok = 1;
+        for (int j = 0; j < 3 && ok; j++) {
+            int idx = mesh->indices ? mesh->indices[i + j] : i + j;
+            if (idx < 0 || idx >= mesh->vertCount) { ok = 0; break; }
+            Vec3 p = world ? render3dMat34Apply(world, mesh->verts[idx]) : mesh->verts[idx];
+            ok = projectPoint(p, &x[j], &y[j], &z[j]);
+        }
+        if (ok) raiseHorizon(x, y, z, mesh->cullMode);
+    }
+}
+
+int horizon3dOccludedAABB(Vec3 min, Vec3 max) {
+    if (gWidth == 0 || gEmpty) return 0;
+
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY;
+    float nearest = INFINITY;
+    for (int k = 0; k < 8; k++) {
+        Vec3 p = v3(k & 1 ? max.x : min.x, k & 2 ? max.y : min.y, k & 4 ? max.z : min.z);
+        float x, y, z;
+        // A box reaching behind the near plane can't be bounded on screen.
+        if (!projectPoint(p, &x, &y, &z)) return 0;
+        minX = fminf(minX, x); maxX = fmaxf(maxX, x);
+        minY = fminf(minY, y);
+        nearest = fminf(nearest, z);
+    }
+
+    // columns whose pixel centers the box can reach
+    int c0 = (int)ceilf(minX - 0.5f), c1 = (int)floorf(maxX - 0.5f);
+    if (c0 < 0) c0 = 0;
+    if (c1 > gWidth - 1) c1 = gWidth - 1;
+    if (c0 > c1) return 0;
+
+    for (int c = c0; c <= c1; c++) {
+        if (minY < gTop[c] + HORIZON3D_EPSILON || nearest < gDepth[c]) return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,27 @@
+#ifndef HORIZON3D_H
+#define HORIZON3D_H
+
+#include "render3d.h"
+
+// Occlusion horizon for heightfield terrain drawn front to back. Each
+// screen column keeps the highest point (smallest y) any occluder reached
+// in it, and the farthest view depth of the triangles that raised it.
+// Seen from above a continuous heightfield, every ray through a column
+// below such a point meets the terrain before that point's depth, so
+// anything under the horizon and behind it is hidden.
+//
+// Only valid for an upright camera (no pitch or roll) above the terrain:
+// then screen columns are vertical planes through the eye.
+
+// Pixels of slack when comparing against the horizon.
+#define HORIZON3D_EPSILON 0.5f
+
+// Resets the horizon to the bottom of the screen for a new view.
+void horizon3dBegin(const Render3DView *vw);
+// Raises the horizon with a mesh's front faces; world may be NULL for
+// world-space meshes.
+void horizon3dAddMesh(const Mesh *mesh, const Mat34 *world);
+// 1 when the world-space box is below the horizon and behind what built it.
+int horizon3dOccludedAABB(Vec3 min, Vec3 max);
+
+#endif
@@ -1,45 +1,88 @@
 
-#include "wolf3d.h"
+#include "level.h"
 #include "../MENGINE/renderer.h"
 
-#define FNL_IMPL
-#include "../lib/FastNoiseLite.h"
+#include "levelcache.h"
+#include "noisegrid.h"
+#include "raster3d.h"
 #include "render3d.h"
+#include "world.h"
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-// -------------------------------------------------------------
-// Shared map config
-// -------------------------------------------------------------
-
-#define MAP_W 50
-#define MAP_H 50
-
-static const float TILE_SIZE   = 1.0f;
-static const float WALL_HEIGHT = 0.1f;
 static const int   GRASS_TEX_SIZE = 32;
 
-// Big height jump treated as a wall
-static const int WALL_DIFF_THRESHOLD = 4;
-
 // -------------------------------------------------------------
-// Global geometry buffers (used from wolf3d.c via extern)
+// Global geometry buffers (declared in level.h)
 // -------------------------------------------------------------
 
-MeshInstance faces[MAP_W * MAP_H * 6];
+LevelInfo levelInfo;
+
+MeshInstance *faces = NULL;
 int faceCount = 0;
 
-MeshInstance floorFaces[MAP_W * MAP_H];
+MeshInstance *wallTiles = NULL;
+int wallTileCount = 0;
+
+// Terrain chunks over shared buffers: merged runs of tiles, and each
+// chunk's 4 index orders back to back.
+TerrainChunk *chunks = NULL;
+int chunkCount = 0;
+
+static Vec3 *terrainVerts = NULL;
+static SDL_FPoint *terrainUVs = NULL;
+static int *terrainIndices = NULL;
+
+// Unmerged tiles, 4 verts and 6 indices each, row by row per chunk
+static Vec3 *detailVerts = NULL;
+static SDL_FPoint *detailUVs = NULL;
+static int *detailIndices = NULL;
+static int *chunkDetailWalls = NULL;
+
+// Per chunk and order: the nearest tile of each run and where its
+// indices start, plus a terminating entry each.
+static int *terrainRunKeys = NULL;
+static int *terrainRunStarts = NULL;
+
+// Per chunk and order: its walls by slot, and the slot (run position
+// in the order) each one is drawn before; lists then slots for every
+// chunk, leaves and LOD, back to back.
+static int *chunkWallStorage = NULL;
+
+// Terrain LOD quadtree: leaves are chunks[], coarser levels lodChunks[]
+// over their own buffers.
+TerrainNode *terrainNodes = NULL;
+int terrainNodeCount = 0;
+int terrainRoot = -1;
+TerrainChunk *lodChunks = NULL;
+int lodChunkCount = 0;
+
+static Vec3 *lodVerts = NULL;
+static SDL_FPoint *lodUVs = NULL;
+static int *lodIndices = NULL;
+static int *lodRunKeys = NULL;
+static int *lodRunStarts = NULL;
+
+MeshInstance *floorFaces = NULL;
 int floorCount = 0;
 
 // -------------------------------------------------------------
 // Heightmap + noise
 // -------------------------------------------------------------
 
-static int LEVEL[MAP_H][MAP_W];
+// levelInfo.width x levelInfo.height heights, row by row
+static int *heightmap = NULL;
 static fnl_state gNoise;
 static SDL_Texture *gGrassTexture = NULL;
+// The grass texture's pixels, kept for the level cache
+static SDL_Surface *gGrassSurface = NULL;
+static int gStreaming = 0;
+// Set when the build went without something for lack of memory; such a
+// level is not cached.
+static int gIncomplete = 0;
 
 static inline int iabs_int(int v) { return v < 0 ? -v : v; }
 
@@ -57,8 +100,13 @@ static inline int imin4(int a, int b, int c, int d) {
     return m;
 }
 
-static SDL_Texture *createGrassTexture(void) {
-    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, GRASS_TEX_SIZE, GRASS_TEX_SIZE, 32, SDL_PIXELFORMAT_RGBA32);
+// The grass tile repeated CHUNK_TILES times each way: SDL_RenderGeometry
+// clamps texture coordinates, so merged terrain runs get their per-tile
+// repeat from chunk-local UVs into this instead. Baked on any thread;
+// uploadGrass turns it into the texture.
+static SDL_Surface *bakeGrass(void) {
+    int size = GRASS_TEX_SIZE * CHUNK_TILES;
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_RGBA32);
     if (!surface) {
         printf("Failed to create grass surface: %s\n", SDL_GetError());
         return NULL;
@@ -81,15 +129,22 @@ static SDL_Texture *createGrassTexture(void) {
         {128, 174, 98, 255},
     };
 
+    // both layers one sample per texel
+    int texels = GRASS_TEX_SIZE * GRASS_TEX_SIZE;
+    float *noise = malloc((size_t)texels * 2 * sizeof(float));
+    if (!noise) {
+        printf("Failed to allocate grass noise\n");
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
+    fnlFillNoise2DGrid(&coarse, 0.0f, 0.0f, 1.0f, 1.0f, GRASS_TEX_SIZE, GRASS_TEX_SIZE, noise);
+    fnlFillNoise2DGrid(&detail, 0.0f, 0.0f, 1.0f, 1.0f, GRASS_TEX_SIZE, GRASS_TEX_SIZE, noise + texels);
+
     SDL_LockSurface(surface);
-    Uint32 *pixels = (Uint32 *)surface->pixels;
     for (int y = 0; y < GRASS_TEX_SIZE; y++) {
         for (int x = 0; x < GRASS_TEX_SIZE; x++) {
-            float nx = (float)x / (float)GRASS_TEX_SIZE;
-            float ny = (float)y / (float)GRASS_TEX_SIZE;
-
-            float large = fnlGetNoise2D(&coarse, nx * GRASS_TEX_SIZE, ny * GRASS_TEX_SIZE);
-            float fine  = fnlGetNoise2D(&detail, nx * GRASS_TEX_SIZE, ny * GRASS_TEX_SIZE);
+            float large = noise[y * GRASS_TEX_SIZE + x];
+            float fine  = noise[texels + y * GRASS_TEX_SIZE + x];
             float value = (large * 0.75f + fine * 0.25f + 1.0f) * 0.5f;
 
             int idx = (int)floorf(value * 4.0f);
@@ -97,19 +152,33 @@ static SDL_Texture *createGrassTexture(void) {
             if (idx > 3) idx = 3;
 
             SDL_Color c = palette[idx];
-            pixels[y * GRASS_TEX_SIZE + x] = SDL_MapRGBA(surface->format, c.r, c.g, c.b, c.a);
+            Uint32 pixel = SDL_MapRGBA(surface->format, c.r, c.g, c.b, c.a);
+            for (int ty = 0; ty < CHUNK_TILES; ty++) {
+                Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels + (ty * GRASS_TEX_SIZE + y) * surface->pitch);
+                for (int tx = 0; tx < CHUNK_TILES; tx++) row[tx * GRASS_TEX_SIZE + x] = pixel;
+            }
         }
     }
     SDL_UnlockSurface(surface);
+    free(noise);
+    return surface;
+}
 
+// Render thread only; keeps the surface as gGrassSurface, or frees it
+// when there is no texture.
+static SDL_Texture *uploadGrass(SDL_Surface *surface) {
+    if (!surface) return NULL;
     SDL_Texture *tex = SDL_CreateTextureFromSurface(renderer, surface);
     if (!tex) {
         printf("Failed to create grass texture: %s\n", SDL_GetError());
-    } else {
-        SDL_SetTextureScaleMode(tex, SDL_ScaleModeNearest);
+        SDL_FreeSurface(surface);
+        return NULL;
     }
+    SDL_SetTextureScaleMode(tex, SDL_ScaleModeNearest);
+    raster3dSetTexturePixels(tex, surface->pixels, surface->w, surface->h, surface->pitch);
 
-    SDL_FreeSurface(surface);
+    SDL_FreeSurface(gGrassSurface);
+    gGrassSurface = surface;
     return tex;
 }
 
@@ -118,9 +187,10 @@ static SDL_Texture *createGrassTexture(void) {
 // -------------------------------------------------------------
 
 int tileHeight(int x, int z) {
-    if (x < 0 || z < 0 || x >= MAP_W || z >= MAP_H)
+    if (gStreaming) return worldTileHeight(x, z);
+    if (x < 0 || z < 0 || x >= levelInfo.width || z >= levelInfo.height)
         return 9;  // big solid outside
-    return LEVEL[z][x];
+    return heightmap[z * levelInfo.width + x];
 }
 
 // sample continuous terrain height at world-space position (x,z)
@@ -131,11 +201,14 @@ float sampleHeightAt(float wx, float wz) {
     int x0 = (int)floorf(gx);
     int z0 = (int)floorf(gz);
 
-    // clamp to valid cell range [0 .. MAP_W-2] / [0 .. MAP_H-2]
-    if (x0 < 0) x0 = 0;
-    if (z0 < 0) z0 = 0;
-    if (x0 > MAP_W - 2) x0 = MAP_W - 2;
-    if (z0 > MAP_H - 2) z0 = MAP_H - 2;
+    // clamp to valid cell range [0 .. tilesX-1] / [0 .. tilesZ-1]; the
+    // streamed world has no edges
+    if (!gStreaming) {
+        if (x0 < 0) x0 = 0;
+        if (z0 < 0) z0 = 0;
+        if (x0 > levelInfo.tilesX - 1) x0 = levelInfo.tilesX - 1;
+        if (z0 > levelInfo.tilesZ - 1) z0 = levelInfo.tilesZ - 1;
+    }
 
     int x1 = x0 + 1;
     int z1 = z0 + 1;
@@ -171,23 +244,48 @@ float sampleHeightAt(float wx, float wz) {
     return y0 + (y1 - y0) * tz;
 }
 
+void levelSetStreaming(int on) {
+    gStreaming = on;
+}
+
+int levelStreaming(void) {
+    return gStreaming;
+}
+
+SDL_Texture *levelGrassTexture(void) {
+    return gGrassTexture;
+}
+
 // -------------------------------------------------------------
 // Level generation
 // -------------------------------------------------------------
 
-static void generateLevel(void) {
-    int cx  = MAP_W / 2;      // center hill
-    int cz  = MAP_H / 2;
+static void setLevelSize(int width, int height) {
+    levelInfo.width = width;
+    levelInfo.height = height;
+    levelInfo.tilesX = width - 1;
+    levelInfo.tilesZ = height - 1;
+    levelInfo.chunksX = (levelInfo.tilesX + CHUNK_TILES - 1) / CHUNK_TILES;
+    levelInfo.chunksZ = (levelInfo.tilesZ + CHUNK_TILES - 1) / CHUNK_TILES;
+}
+
+// Heightmap rows z0 to z1 - 1; noise holds a map-sized grid for the bumps,
+// or is NULL to sample them one at a time.
+static void generateRows(int z0, int z1, float *noise) {
+    int cx  = levelInfo.width / 2;      // center hill
+    int cz  = levelInfo.height / 2;
 
-    int cx2 = MAP_W / 4;      // side hill
-    int cz2 = MAP_H / 3;
+    int cx2 = levelInfo.width / 4;      // side hill
+    int cz2 = levelInfo.height / 3;
 
-    for (int z = 0; z < MAP_H; z++) {
-        for (int x = 0; x < MAP_W; x++) {
+    if (noise) fnlFillNoise2DRows(&gNoise, 0.0f, 0.0f, 1.0f, 1.0f, levelInfo.width, z0, z1, noise);
+
+    for (int z = z0; z < z1; z++) {
+        for (int x = 0; x < levelInfo.width; x++) {
 
             // outer border wall (solid, ignore noise)
-            if (x == 0 || z == 0 || x == MAP_W - 1 || z == MAP_H - 1) {
-                LEVEL[z][x] = 4;
+            if (x == 0 || z == 0 || x == levelInfo.tilesX || z == levelInfo.tilesZ) {
+                heightmap[z * levelInfo.width + x] = 4;
                 continue;
             }
 
@@ -216,7 +314,7 @@ static void generateLevel(void) {
 
             // pit test area
             if (x >= 25 && x <= 28 && z >= 10 && z <= 13) {
-                LEVEL[z][x] = -1;
+                heightmap[z * levelInfo.width + x] = -1;
                 continue;
             }
 
@@ -234,7 +332,8 @@ static void generateLevel(void) {
 
             // Perlin noise modulation
             {
-                float n = fnlGetNoise2D(&gNoise, (float)x, (float)z); // [-1,1]
+                float n = noise ? noise[z * levelInfo.width + x]
+                                : fnlGetNoise2D(&gNoise, (float)x, (float)z); // [-1,1]
                 int bump = (int)roundf(n * 2.0f); // mostly -2..+2
                 h += bump;
             }
@@ -242,7 +341,7 @@ static void generateLevel(void) {
             if (h > 4)  h = 4;
             if (h < -2) h = -2;
 
-            LEVEL[z][x] = h;
+            heightmap[z * levelInfo.width + x] = h;
         }
     }
 }
@@ -251,174 +350,1629 @@ static void generateLevel(void) {
 // Geometry build: sloped terrain + walls where diff >= 4
 // -------------------------------------------------------------
 
-static void buildLevelGeometry(void) {
-    faceCount = 0;
+// Walls are single sided and merged into runs along their line: a run
+// covers len tiles from tile (x, z), on its +x (axis 0) or +z (axis 1)
+// side. flip swaps winding so the wall always faces the lower tile and its
+// back can be culled.
+typedef struct {
+    int x, z, axis, len;
+    int hLow, hHigh;
+    int flip;
+    SDL_Color col;
+} WallRun;
+
+// wallRuns parallels faces[], wallTileRuns wallTiles[]; wallCapacity
+// is the number of wall tile edges in the level, which bounds both.
+static WallRun *wallRuns = NULL;
+static WallRun *wallTileRuns = NULL;
+static int wallCapacity = 0;
+
+static int chunkOfTile(int x, int z) {
+    // walls past the last tile row/column belong to the edge tile
+    if (x > levelInfo.tilesX - 1) x = levelInfo.tilesX - 1;
+    if (z > levelInfo.tilesZ - 1) z = levelInfo.tilesZ - 1;
+    return (z / CHUNK_TILES) * levelInfo.chunksX + x / CHUNK_TILES;
+}
+
+static void buildWallQuad(MeshInstance *inst, const WallRun *run) {
+    float fx = (run->x + (run->axis == 0)) * TILE_SIZE;
+    float fz = (run->z + (run->axis == 1)) * TILE_SIZE;
+    float ex = run->axis == 1 ? run->len * TILE_SIZE : 0.0f;
+    float ez = run->axis == 0 ? run->len * TILE_SIZE : 0.0f;
+    float yLow  = run->hLow  * WALL_HEIGHT;
+    float yHigh = run->hHigh * WALL_HEIGHT;
+
+    Vec3 a = v3(fx,      yLow,  fz);
+    Vec3 b = v3(fx + ex, yLow,  fz + ez);
+    Vec3 c = v3(fx + ex, yHigh, fz + ez);
+    Vec3 d = v3(fx,      yHigh, fz);
+
+    // u repeats once per tile along the run
+    SDL_FPoint uvA = {0.0f, 0.0f};
+    SDL_FPoint uvB = {(float)run->len, 0.0f};
+    SDL_FPoint uvC = {(float)run->len, 1.0f};
+    SDL_FPoint uvD = {0.0f, 1.0f};
+
+    if (run->flip) render3dInitQuadMeshUV(inst, a, d, c, b, run->col, uvA, uvD, uvC, uvB);
+    else           render3dInitQuadMeshUV(inst, a, b, c, d, run->col, uvA, uvB, uvC, uvD);
+    inst->mesh.cullMode = RENDER3D_CULL_BACK;
+}
+
+static void addWall(WallRun wall) {
+    wall.len = 1;
+    if (wallTileCount < wallCapacity) wallTileRuns[wallTileCount++] = wall;
+
+    // Walls along x extend the previous one when they continue it in the
+    // same chunk. Walls along z stay single so each still sorts between
+    // the two tiles of its row.
+    if (faceCount > 0) {
+        WallRun *prev = &wallRuns[faceCount - 1];
+        int px = prev->x + (prev->axis == 1 ? prev->len : 0);
+        int pz = prev->z + (prev->axis == 0 ? prev->len : 0);
+        if (wall.axis == 1 && prev->axis == 1 && px == wall.x && pz == wall.z &&
+            prev->hLow == wall.hLow && prev->hHigh == wall.hHigh && prev->flip == wall.flip &&
+            chunkOfTile(prev->x, prev->z) == chunkOfTile(wall.x, wall.z)) {
+            prev->len++;
+            return;
+        }
+    }
+
+    if (faceCount >= wallCapacity) return;
+    wallRuns[faceCount++] = wall;
+}
+
+// Corner heights of terrain tile (x, z) in height steps: smooth slope, or
+// flattened to the lower side when a big cliff crosses the cell; returns 1
+// for those.
+static int terrainTileHeights(int x, int z, int h[4]) {
+    int h00 = tileHeight(x,     z);
+    int h10 = tileHeight(x + 1, z);
+    int h01 = tileHeight(x,     z + 1);
+    int h11 = tileHeight(x + 1, z + 1);
 
+    int d0 = iabs_int(h00 - h10);
+    int d1 = iabs_int(h10 - h11);
+    int d2 = iabs_int(h11 - h01);
+    int d3 = iabs_int(h01 - h00);
+    int maxDiff = imax4(d0, d1, d2, d3);
+
+    if (maxDiff >= WALL_DIFF_THRESHOLD) {
+        int hMin = imin4(h00, h10, h01, h11);
+        h[0] = h[1] = h[2] = h[3] = hMin;
+        return 1;
+    }
+    h[0] = h00;
+    h[1] = h10;
+    h[2] = h11;
+    h[3] = h01;
+    return 0;
+}
+
+// A planar tile's heights as a plane over chunk-local tile corners:
+// h = base + dx * x + dz * z. Tiles on the same plane merge.
+typedef struct {
+    int planar;
+    int base, dx, dz;
+} TilePlane;
+
+static int samePlane(TilePlane a, TilePlane b) {
+    return a.planar && b.planar && a.base == b.base && a.dx == b.dx && a.dz == b.dz;
+}
+
+// Merged run of w tiles in one row, chunk-local. Skirts hang below a
+// chunk's borders and go first in every order.
+typedef struct {
+    int x, z, w;
+    int firstIndex, indexCount;
+    int skirt;
+} TerrainRun;
+
+static int terrainTileCount = 0;
+static int terrainRunCount = 0;
+
+static void emitTerrainVert(Vec3 *verts, SDL_FPoint *uvs, int *vertCount, int x, int z, int h, int cx0, int cz0) {
+    verts[*vertCount] = v3(x * TILE_SIZE, h * WALL_HEIGHT, z * TILE_SIZE);
+    // chunk-local UVs into the chunk-sized repeat of the grass tile
+    uvs[*vertCount] = (SDL_FPoint){
+        (float)(x - cx0) / (float)CHUNK_TILES,
+        (float)(z - cz0) / (float)CHUNK_TILES,
+    };
+    (*vertCount)++;
+}
+
+// Writes a chunk's runs in its four orders: runs go by their nearest
+// cell, so a run is drawn once everything behind its front has been.
+// indices takes triIndexCount * 4 entries, keys and starts
+// (runCount + 1) * 4 each.
+static void buildChunkOrders(TerrainChunk *chunk, const TerrainRun *runs, int runCount,
+                             const int *tris, int triIndexCount,
+                             int *indices, int *keys, int *starts) {
+    int w = chunk->tilesX, h = chunk->tilesZ;
+    chunk->runCount = runCount;
+    for (int o = 0; o < 4; o++) {
+        int *oKeys = keys + o * (runCount + 1);
+        int *oStarts = starts + o * (runCount + 1);
+        int sorted[CHUNK_TILES * CHUNK_TILES + 1];
+        for (int k = 0; k < runCount; k++) {
+            const TerrainRun *r = &runs[k];
+            int row = (o & 2) ? h - 1 - r->z : r->z;
+            int col = (o & 1) ? w - 1 - r->x : r->x + r->w - 1;
+            int key = r->skirt ? -1 : row * w + col;
+            int j = k;
+            while (j > 0 && oKeys[j - 1] > key) {
+                oKeys[j] = oKeys[j - 1];
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            oKeys[j] = key;
+            sorted[j] = k;
+        }
+        oKeys[runCount] = w * h;
+
+        int *out = indices + o * triIndexCount;
+        chunk->orders[o] = out;
+        chunk->runKeys[o] = oKeys;
+        chunk->runStarts[o] = oStarts;
+        for (int k = 0; k < runCount; k++) {
+            const TerrainRun *r = &runs[sorted[k]];
+            oStarts[k] = (int)(out - chunk->orders[o]);
+            for (int i = 0; i < r->indexCount; i++) *out++ = tris[r->firstIndex + i];
+        }
+        oStarts[runCount] = triIndexCount;
+    }
+}
+
+// Terrain buffers for every chunk; 0 when out of memory. Each chunk gets
+// fixed ranges sized to its tiles, so chunk rows can be built in any order.
+static int allocTerrainChunks(void) {
+    // every tile at most once in each buffer; runs only merge them
+    size_t tiles = (size_t)levelInfo.tilesX * (size_t)levelInfo.tilesZ;
+    size_t chunkTotal = (size_t)levelInfo.chunksX * (size_t)levelInfo.chunksZ;
+    chunks = calloc(chunkTotal, sizeof(TerrainChunk));
+    terrainVerts = malloc(tiles * 4 * sizeof(Vec3));
+    terrainUVs = malloc(tiles * 4 * sizeof(SDL_FPoint));
+    terrainIndices = malloc(tiles * 6 * 4 * sizeof(int));
+    detailVerts = malloc(tiles * 4 * sizeof(Vec3));
+    detailUVs = malloc(tiles * 4 * sizeof(SDL_FPoint));
+    detailIndices = malloc(tiles * 6 * sizeof(int));
+    terrainRunKeys = malloc((tiles + chunkTotal) * 4 * sizeof(int));
+    terrainRunStarts = malloc((tiles + chunkTotal) * 4 * sizeof(int));
+    if (!chunks || !terrainVerts || !terrainUVs || !terrainIndices || !detailVerts ||
+        !detailUVs || !detailIndices || !terrainRunKeys || !terrainRunStarts) {
+        printf("Failed to allocate terrain for %dx%d tiles\n", levelInfo.tilesX, levelInfo.tilesZ);
+        return 0;
+    }
+    chunkCount = (int)chunkTotal;
+    return 1;
+}
+
+// Builds chunk row cz from heightmap rows cz * CHUNK_TILES to
+// (cz + 1) * CHUNK_TILES. Any thread; textures come in finishTerrainChunks.
+static void buildChunkRow(int cz) {
+    int z0 = cz * CHUNK_TILES;
+    int z1 = z0 + CHUNK_TILES < levelInfo.tilesZ ? z0 + CHUNK_TILES : levelInfo.tilesZ;
+    int h = z1 - z0;
+    for (int cx = 0; cx < levelInfo.chunksX; cx++) {
+        int x0 = cx * CHUNK_TILES;
+        int x1 = x0 + CHUNK_TILES < levelInfo.tilesX ? x0 + CHUNK_TILES : levelInfo.tilesX;
+        int w = x1 - x0;
+        int chunkIndex = cz * levelInfo.chunksX + cx;
+        // tiles in the chunks before this one
+        int tileBase = z0 * levelInfo.tilesX + h * x0;
+        int vStart = tileBase * 4, vertCount = vStart;
+        int dStart = tileBase, detailCount = dStart;
+
+        TilePlane planes[CHUNK_TILES][CHUNK_TILES];
+        int heights[CHUNK_TILES][CHUNK_TILES][4];
+        int used[CHUNK_TILES][CHUNK_TILES] = {{0}};
+        for (int lz = 0; lz < h; lz++) {
+            for (int lx = 0; lx < w; lx++) {
+                int *q = heights[lz][lx];
+                int cliff = terrainTileHeights(x0 + lx, z0 + lz, q);
+                int dv = detailCount * 4;
+                emitTerrainVert(detailVerts, detailUVs, &dv, x0 + lx,     z0 + lz,     q[0], x0, z0);
+                emitTerrainVert(detailVerts, detailUVs, &dv, x0 + lx + 1, z0 + lz,     q[1], x0, z0);
+                emitTerrainVert(detailVerts, detailUVs, &dv, x0 + lx + 1, z0 + lz + 1, q[2], x0, z0);
+                emitTerrainVert(detailVerts, detailUVs, &dv, x0 + lx,     z0 + lz + 1, q[3], x0, z0);
+                int quad[6] = {0, 1, 2, 0, 2, 3};
+                int base = (detailCount - dStart) * 4;
+                for (int k = 0; k < 6; k++) detailIndices[detailCount * 6 + k] = base + quad[k];
+                detailCount++;
+
+                // cliff tiles sit under walls and stay single, so
+                // walls keep sorting against small tiles
+                TilePlane p = {!cliff && q[0] + q[2] == q[1] + q[3], 0, q[1] - q[0], q[3] - q[0]};
+                p.base = q[0] - p.dx * lx - p.dz * lz;
+                planes[lz][lx] = p;
+            }
+        }
+
+        // Greedy merge along x: each unused tile grows over the
+        // coplanar tiles after it in its row. Runs stay one row high so
+        // they keep sorting against walls and the next row like single
+        // tiles. Runs are two triangles; their edges can T-junction with
+        // smaller neighbours, which costs at most a stray pixel where
+        // the rasterizer rounds differently.
+        TerrainRun runs[CHUNK_TILES * CHUNK_TILES];
+        int runCount = 0;
+        int tris[CHUNK_TILES * CHUNK_TILES * 6];
+        int triIndexCount = 0;
+        for (int lz = 0; lz < h; lz++) {
+            for (int lx = 0; lx < w; lx++) {
+                if (used[lz][lx]) continue;
+                TilePlane p = planes[lz][lx];
+                int rw = 1;
+                if (p.planar) {
+                    while (lx + rw < w && !used[lz][lx + rw] && samePlane(p, planes[lz][lx + rw])) rw++;
+                }
+                for (int k = 0; k < rw; k++) used[lz][lx + k] = 1;
+
+                TerrainRun *r = &runs[runCount++];
+                *r = (TerrainRun){lx, lz, rw, triIndexCount, 0, 0};
+                // a lone non-planar tile keeps its own corners
+                int ch[4];
+                if (p.planar) {
+                    ch[0] = p.base + p.dx * lx        + p.dz * lz;
+                    ch[1] = p.base + p.dx * (lx + rw) + p.dz * lz;
+                    ch[2] = p.base + p.dx * (lx + rw) + p.dz * (lz + 1);
+                    ch[3] = p.base + p.dx * lx        + p.dz * (lz + 1);
+                } else {
+                    for (int k = 0; k < 4; k++) ch[k] = heights[lz][lx][k];
+                }
+                int base = vertCount - vStart;
+                emitTerrainVert(terrainVerts, terrainUVs, &vertCount, x0 + lx,      z0 + lz,      ch[0], x0, z0);
+                emitTerrainVert(terrainVerts, terrainUVs, &vertCount, x0 + lx + rw, z0 + lz,      ch[1], x0, z0);
+                emitTerrainVert(terrainVerts, terrainUVs, &vertCount, x0 + lx + rw, z0 + lz + 1,  ch[2], x0, z0);
+                emitTerrainVert(terrainVerts, terrainUVs, &vertCount, x0 + lx,      z0 + lz + 1,  ch[3], x0, z0);
+                int quad[6] = {0, 1, 2, 0, 2, 3};
+                for (int k = 0; k < 6; k++) tris[triIndexCount++] = base + quad[k];
+                r->indexCount = triIndexCount - r->firstIndex;
+            }
+        }
+
+        TerrainChunk *chunk = &chunks[chunkIndex];
+        chunk->level = 0;
+        chunk->tileX = x0;
+        chunk->tileZ = z0;
+        chunk->tilesX = w;
+        chunk->tilesZ = h;
+        int runSlots = (tileBase + chunkIndex) * 4;
+        buildChunkOrders(chunk, runs, runCount, tris, triIndexCount,
+                         &terrainIndices[tileBase * 6 * 4], &terrainRunKeys[runSlots], &terrainRunStarts[runSlots]);
+
+        Mesh mesh = {
+            &terrainVerts[vStart], &terrainUVs[vStart], vertCount - vStart,
+            chunk->orders[0], triIndexCount,
+            NULL, RENDER3D_CULL_BACK,
+        };
+        render3dInitMeshInstance(&chunk->inst, mesh, (SDL_Color){255, 255, 255, 255});
+        chunk->detail = (Mesh){
+            &detailVerts[dStart * 4], &detailUVs[dStart * 4], w * h * 4,
+            &detailIndices[dStart * 6], w * h * 6,
+            NULL, RENDER3D_CULL_BACK,
+        };
+    }
+}
+
+// Once the grass is uploaded: textures and colour on the chunks, and the
+// totals for the stats line.
+static void finishTerrainChunks(void) {
     SDL_Color terrainColor = gGrassTexture ?
         (SDL_Color){255, 255, 255, 255} :
         (SDL_Color){180, 180, 200, 255};
-    SDL_Color wallColorPos = (SDL_Color){220, 220, 240, 255};
-    SDL_Color wallColorNeg = (SDL_Color){140, 140, 170, 255};
+    terrainTileCount = levelInfo.tilesX * levelInfo.tilesZ;
+    terrainRunCount = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        chunks[c].inst.mesh.texture = gGrassTexture;
+        chunks[c].inst.color = terrainColor;
+        chunks[c].detail.texture = gGrassTexture;
+        terrainRunCount += chunks[c].runCount;
+    }
+    for (int c = 0; c < lodChunkCount; c++) {
+        lodChunks[c].inst.mesh.texture = gGrassTexture;
+        lodChunks[c].inst.color = terrainColor;
+    }
+}
+
+// -------------------------------------------------------------
+// Terrain LOD: quadtree of coarser chunks over the leaf chunks
+// -------------------------------------------------------------
 
-    // 1) heightfield terrain as quads with per-corner heights
-    for (int z = 0; z < MAP_H - 1; z++) {
-        for (int x = 0; x < MAP_W - 1; x++) {
-            if (faceCount >= (int)(sizeof(faces)/sizeof(faces[0]))) break;
-
-            int h00 = tileHeight(x,     z);
-            int h10 = tileHeight(x + 1, z);
-            int h01 = tileHeight(x,     z + 1);
-            int h11 = tileHeight(x + 1, z + 1);
-
-            int d0 = iabs_int(h00 - h10);
-            int d1 = iabs_int(h10 - h11);
-            int d2 = iabs_int(h11 - h01);
-            int d3 = iabs_int(h01 - h00);
-            int maxDiff = imax4(d0, d1, d2, d3);
-
-            float y00, y10, y01, y11;
-
-            if (maxDiff >= WALL_DIFF_THRESHOLD) {
-                // Big cliff crosses this cell: flatten to the lower side
-                int hMin = imin4(h00, h10, h01, h11);
-                y00 = y10 = y01 = y11 = hMin * WALL_HEIGHT;
-            } else {
-                // Normal smooth slope
-                y00 = h00 * WALL_HEIGHT;
-                y10 = h10 * WALL_HEIGHT;
-                y01 = h01 * WALL_HEIGHT;
-                y11 = h11 * WALL_HEIGHT;
+// A level L chunk covers 2^L x 2^L leaf chunks with the same grid of
+// CHUNK_TILES x CHUNK_TILES cells, each 2^L tiles across, over heights
+// sampled from the tile grid at the cell corners.
+#define LOD_CHUNK_RUNS (CHUNK_TILES * CHUNK_TILES + 1)
+#define LOD_CHUNK_QUADS (CHUNK_TILES * CHUNK_TILES + 4 * CHUNK_TILES)
+
+static int imin_int(int a, int b) { return a < b ? a : b; }
+
+// Grass UVs for tile corner (x, z) of a cell starting at (cellX, cellZ):
+// the texture holds CHUNK_TILES tiles, so cells up to that size keep the
+// leaf chunks' pattern and bigger ones stretch it.
+static void emitLodVert(int *vertCount, int x, int z, float y, int cellX, int cellZ, int span) {
+    lodVerts[*vertCount] = v3(x * TILE_SIZE, y, z * TILE_SIZE);
+    lodUVs[*vertCount] = (SDL_FPoint){
+        (float)(cellX % span + x - cellX) / (float)span,
+        (float)(cellZ % span + z - cellZ) / (float)span,
+    };
+    (*vertCount)++;
+}
+
+// LOD chunk k (node chunkCount + k) over fixed ranges of the LOD buffers.
+// Any thread once the heightmap is done; the tree is linked afterwards.
+static void buildLodChunk(int k, int level, int tx0, int tz0) {
+    TerrainNode *node = &terrainNodes[chunkCount + k];
+    TerrainChunk *chunk = &lodChunks[k];
+    int firstVert = k * LOD_CHUNK_QUADS * 4;
+    int *vertCount = &firstVert;
+    int s = 1 << level;
+    int span = s > CHUNK_TILES ? s : CHUNK_TILES;
+    int tilesW = levelInfo.tilesX, tilesH = levelInfo.tilesZ;
+    int cellsX = imin_int((tilesW - tx0 + s - 1) / s, CHUNK_TILES);
+    int cellsZ = imin_int((tilesH - tz0 + s - 1) / s, CHUNK_TILES);
+
+    // cell corners in tiles, clipped to the map, and their heights
+    int gx[CHUNK_TILES + 1], gz[CHUNK_TILES + 1];
+    int grid[CHUNK_TILES + 1][CHUNK_TILES + 1];
+    for (int i = 0; i <= cellsX; i++) gx[i] = imin_int(tx0 + i * s, tilesW);
+    for (int j = 0; j <= cellsZ; j++) gz[j] = imin_int(tz0 + j * s, tilesH);
+    for (int j = 0; j <= cellsZ; j++) {
+        for (int i = 0; i <= cellsX; i++) grid[j][i] = tileHeight(gx[i], gz[j]);
+    }
+
+    // Error: how far the tile corners, raw and as drawn, stray from the
+    // cells' triangles. The raw range also bounds the walls.
+    float err = 0.0f;
+    int hMin = grid[0][0], hMax = grid[0][0];
+    for (int tz = tz0; tz < gz[cellsZ]; tz++) {
+        for (int tx = tx0; tx < gx[cellsX]; tx++) {
+            int ci = (tx - tx0) >> level, cj = (tz - tz0) >> level;
+            int h00 = grid[cj][ci],     h10 = grid[cj][ci + 1];
+            int h01 = grid[cj + 1][ci], h11 = grid[cj + 1][ci + 1];
+            int drawn[4];
+            terrainTileHeights(tx, tz, drawn);
+            for (int k = 0; k < 4; k++) {
+                int px = tx + (k == 1 || k == 2), pz = tz + (k >= 2);
+                int raw = tileHeight(px, pz);
+                if (raw < hMin) hMin = raw;
+                if (raw > hMax) hMax = raw;
+                float fx = (float)(px - gx[ci]) / (float)(gx[ci + 1] - gx[ci]);
+                float fz = (float)(pz - gz[cj]) / (float)(gz[cj + 1] - gz[cj]);
+                // same diagonal as the cell's two triangles
+                float c = fx >= fz ? h00 + (h10 - h00) * fx + (h11 - h10) * fz
+                                   : h00 + (h01 - h00) * fz + (h11 - h01) * fx;
+                err = fmaxf(err, fmaxf(fabsf((float)drawn[k] - c), fabsf((float)raw - c)));
             }
+        }
+    }
 
-            float fx = x * TILE_SIZE;
-            float fz = z * TILE_SIZE;
+    int vStart = *vertCount;
+    TerrainRun runs[LOD_CHUNK_RUNS];
+    int tris[LOD_CHUNK_QUADS * 6];
+    int runCount = 0, triIndexCount = 0;
+    int quad[6] = {0, 1, 2, 0, 2, 3};
+    for (int cj = 0; cj < cellsZ; cj++) {
+        for (int ci = 0; ci < cellsX; ci++) {
+            int base = *vertCount - vStart;
+            emitLodVert(vertCount, gx[ci],     gz[cj],     grid[cj][ci] * WALL_HEIGHT,         gx[ci], gz[cj], span);
+            emitLodVert(vertCount, gx[ci + 1], gz[cj],     grid[cj][ci + 1] * WALL_HEIGHT,     gx[ci], gz[cj], span);
+            emitLodVert(vertCount, gx[ci + 1], gz[cj + 1], grid[cj + 1][ci + 1] * WALL_HEIGHT, gx[ci], gz[cj], span);
+            emitLodVert(vertCount, gx[ci],     gz[cj + 1], grid[cj + 1][ci] * WALL_HEIGHT,     gx[ci], gz[cj], span);
+            runs[runCount++] = (TerrainRun){ci, cj, 1, triIndexCount, 6, 0};
+            for (int k = 0; k < 6; k++) tris[triIndexCount++] = base + quad[k];
+        }
+    }
 
-            SDL_FPoint uv0 = {0.0f, 0.0f};
-            SDL_FPoint uv1 = {1.0f, 0.0f};
-            SDL_FPoint uv2 = {1.0f, 1.0f};
-            SDL_FPoint uv3 = {0.0f, 1.0f};
+    // Skirts hang err below the borders inside the map: finer neighbours
+    // meet this surface within err, so the cracks between them show skirt.
+    // They face outwards, and the back faces are culled from inside.
+    float depth = (err + 1.0f) * WALL_HEIGHT;
+    if (err > 0.0f) {
+        TerrainRun *skirt = &runs[runCount++];
+        *skirt = (TerrainRun){0, 0, 0, triIndexCount, 0, 1};
+        for (int side = 0; side < 4; side++) {
+            // -z, +x, +z, -x
+            int alongX = side == 0 || side == 2;
+            int onMapEdge = side == 0 ? tz0 == 0 : side == 1 ? gx[cellsX] == tilesW
+                          : side == 2 ? gz[cellsZ] == tilesH : tx0 == 0;
+            if (onMapEdge) continue;
+            Vec3 out = side == 0 ? v3(0, 0, -1) : side == 1 ? v3(1, 0, 0) : side == 2 ? v3(0, 0, 1) : v3(-1, 0, 0);
+            int segments = alongX ? cellsX : cellsZ;
+            for (int i = 0; i < segments; i++) {
+                int ax, az, bx, bz;
+                if (alongX) {
+                    int j = side == 0 ? 0 : cellsZ;
+                    ax = i; bx = i + 1; az = bz = j;
+                } else {
+                    int k = side == 3 ? 0 : cellsX;
+                    az = i; bz = i + 1; ax = bx = k;
+                }
+                Vec3 pa = v3(gx[ax] * TILE_SIZE, grid[az][ax] * WALL_HEIGHT, gz[az] * TILE_SIZE);
+                Vec3 pb = v3(gx[bx] * TILE_SIZE, grid[bz][bx] * WALL_HEIGHT, gz[bz] * TILE_SIZE);
+                Vec3 pc = v3(pb.x, pb.y - depth, pb.z);
+                // wind it front-facing along out, as the cells are along +y
+                if (v3_dot(v3_cross(v3_sub(pb, pa), v3_sub(pc, pa)), out) > 0.0f) {
+                    int t = ax; ax = bx; bx = t;
+                    t = az; az = bz; bz = t;
+                }
+                int cellX = gx[imin_int(ax, bx)], cellZ = gz[imin_int(az, bz)];
+                int base = *vertCount - vStart;
+                emitLodVert(vertCount, gx[ax], gz[az], grid[az][ax] * WALL_HEIGHT,         cellX, cellZ, span);
+                emitLodVert(vertCount, gx[bx], gz[bz], grid[bz][bx] * WALL_HEIGHT,         cellX, cellZ, span);
+                emitLodVert(vertCount, gx[bx], gz[bz], grid[bz][bx] * WALL_HEIGHT - depth, cellX, cellZ, span);
+                emitLodVert(vertCount, gx[ax], gz[az], grid[az][ax] * WALL_HEIGHT - depth, cellX, cellZ, span);
+                for (int k = 0; k < 6; k++) tris[triIndexCount++] = base + quad[k];
+            }
+        }
+        skirt->indexCount = triIndexCount - skirt->firstIndex;
+        if (skirt->indexCount == 0) runCount--;
+    }
 
-            render3dInitQuadMeshUV(&faces[faceCount++],
-                v3(fx,            y00, fz),
-                v3(fx+TILE_SIZE,  y10, fz),
-                v3(fx+TILE_SIZE,  y11, fz+TILE_SIZE),
-                v3(fx,            y01, fz+TILE_SIZE),
-                terrainColor,
-                uv0, uv1, uv2, uv3);
+    chunk->level = level;
+    chunk->tileX = tx0;
+    chunk->tileZ = tz0;
+    chunk->tilesX = cellsX;
+    chunk->tilesZ = cellsZ;
+    int runSlots = k * (LOD_CHUNK_RUNS + 1) * 4;
+    buildChunkOrders(chunk, runs, runCount, tris, triIndexCount,
+                     &lodIndices[k * LOD_CHUNK_QUADS * 6 * 4], &lodRunKeys[runSlots], &lodRunStarts[runSlots]);
+
+    Mesh mesh = {
+        &lodVerts[vStart], &lodUVs[vStart], *vertCount - vStart,
+        chunk->orders[0], triIndexCount,
+        NULL, RENDER3D_CULL_BACK,
+    };
+    render3dInitMeshInstance(&chunk->inst, mesh, (SDL_Color){255, 255, 255, 255});
+
+    node->level = level;
+    node->chunk = chunk;
+    node->error = err * WALL_HEIGHT;
+    node->min = v3(tx0 * TILE_SIZE, hMin * WALL_HEIGHT - (err > 0.0f ? depth : 0.0f), tz0 * TILE_SIZE);
+    node->max = v3(gx[cellsX] * TILE_SIZE, hMax * WALL_HEIGHT, gz[cellsZ] * TILE_SIZE);
+}
 
-            if (faceCount > 0) {
-                faces[faceCount - 1].mesh.texture = gGrassTexture;
+static void freeTerrainLod(void) {
+    free(terrainNodes);
+    free(lodChunks);
+    free(lodVerts);
+    free(lodUVs);
+    free(lodIndices);
+    free(lodRunKeys);
+    free(lodRunStarts);
+    terrainNodes = NULL;
+    lodChunks = NULL;
+    lodVerts = NULL;
+    lodUVs = NULL;
+    lodIndices = NULL;
+    lodRunKeys = NULL;
+    lodRunStarts = NULL;
+    terrainNodeCount = 0;
+    lodChunkCount = 0;
+    terrainRoot = -1;
+}
+
+// Leaf nodes come first, one per chunk in the same order; each level above
+// halves the grid until one node covers the map. Allocates the tree and
+// sets lodChunkCount; without memory the level goes without LOD.
+static void allocTerrainLod(void) {
+    freeTerrainLod();
+
+    int coarse = 0;
+    for (int w = levelInfo.chunksX, h = levelInfo.chunksZ; w > 1 || h > 1; ) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        coarse += w * h;
+    }
+
+    terrainNodes = malloc((size_t)(chunkCount + coarse) * sizeof(TerrainNode));
+    lodChunks = calloc((size_t)(coarse > 0 ? coarse : 1), sizeof(TerrainChunk));
+    lodVerts = malloc((size_t)(coarse * LOD_CHUNK_QUADS * 4 + 1) * sizeof(Vec3));
+    lodUVs = malloc((size_t)(coarse * LOD_CHUNK_QUADS * 4 + 1) * sizeof(SDL_FPoint));
+    lodIndices = malloc((size_t)(coarse * LOD_CHUNK_QUADS * 6 * 4 + 1) * sizeof(int));
+    lodRunKeys = malloc((size_t)(coarse * (LOD_CHUNK_RUNS + 1) * 4 + 1) * sizeof(int));
+    lodRunStarts = malloc((size_t)(coarse * (LOD_CHUNK_RUNS + 1) * 4 + 1) * sizeof(int));
+    if (!terrainNodes || !lodChunks || !lodVerts || !lodUVs || !lodIndices || !lodRunKeys || !lodRunStarts) {
+        printf("Failed to allocate terrain LOD\n");
+        gIncomplete = 1;
+        freeTerrainLod();
+        return;
+    }
+    lodChunkCount = coarse;
+}
+
+// Leaf node for chunk c, bounding its heights.
+static void buildLeafNode(int c) {
+    TerrainChunk *chunk = &chunks[c];
+    int hMin = tileHeight(chunk->tileX, chunk->tileZ), hMax = hMin;
+    for (int z = chunk->tileZ; z <= chunk->tileZ + chunk->tilesZ; z++) {
+        for (int x = chunk->tileX; x <= chunk->tileX + chunk->tilesX; x++) {
+            int h = tileHeight(x, z);
+            if (h < hMin) hMin = h;
+            if (h > hMax) hMax = h;
+        }
+    }
+    terrainNodes[c] = (TerrainNode){0, chunk, -1, {-1, -1, -1, -1}, 0.0f,
+        v3(chunk->tileX * TILE_SIZE, hMin * WALL_HEIGHT, chunk->tileZ * TILE_SIZE),
+        v3((chunk->tileX + chunk->tilesX) * TILE_SIZE, hMax * WALL_HEIGHT, (chunk->tileZ + chunk->tilesZ) * TILE_SIZE)};
+}
+
+// LOD chunk k: finds its level and place in that level's grid.
+static void buildLodTask(int k) {
+    int w = levelInfo.chunksX, h = levelInfo.chunksZ;
+    int i = k;
+    for (int level = 1; w > 1 || h > 1; level++) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        if (i < w * h) {
+            buildLodChunk(k, level, (i % w) * (CHUNK_TILES << level), (i / w) * (CHUNK_TILES << level));
+            return;
+        }
+        i -= w * h;
+    }
+}
+
+// Once every node is built: parents, children and the root.
+static void linkTerrainLod(void) {
+    if (!terrainNodes) return;
+    terrainNodeCount = chunkCount + lodChunkCount;
+    int prevStart = 0, prevW = levelInfo.chunksX, prevH = levelInfo.chunksZ;
+    int start = chunkCount;
+    while (prevW > 1 || prevH > 1) {
+        int w = (prevW + 1) / 2, h = (prevH + 1) / 2;
+        for (int nz = 0; nz < h; nz++) {
+            for (int nx = 0; nx < w; nx++) {
+                int n = start + nz * w + nx;
+                TerrainNode *node = &terrainNodes[n];
+                node->parent = -1;
+                for (int k = 0; k < 4; k++) {
+                    int cx = nx * 2 + (k & 1), cz = nz * 2 + (k >> 1);
+                    int child = cx < prevW && cz < prevH ? prevStart + cz * prevW + cx : -1;
+                    node->children[k] = child;
+                    if (child >= 0) terrainNodes[child].parent = n;
+                }
             }
         }
+        prevStart = start;
+        start += w * h;
+        prevW = w;
+        prevH = h;
     }
+    terrainRoot = terrainNodeCount - 1;
+}
 
-    // 2) vertical walls where height diff >= 4 between neighbors
+// Where wall run i goes in order o of a chunk: between the two cells when
+// they share a row, between the two rows when it runs along one, and just
+// after its cell when it falls inside a coarse cell. Slots count terrain
+// runs, so the wall lands before the first run whose nearest cell is at
+// or past it.
+static int wallSlot(const TerrainChunk *chunk, const WallRun *run, int o) {
+    int w = chunk->tilesX, h = chunk->tilesZ;
+    int mask = (1 << chunk->level) - 1;
+    int lx = imin_int((run->x - chunk->tileX) >> chunk->level, w - 1);
+    int lz = imin_int((run->z - chunk->tileZ) >> chunk->level, h - 1);
+    int onEdge = run->axis == 0 ? ((run->x + 1 - chunk->tileX) & mask) == 0
+                                : ((run->z + 1 - chunk->tileZ) & mask) == 0;
+    // the cell across the wall comes first when running downwards
+    int otherFirst = !onEdge ? 0 : run->axis == 0 ? (o & 1) : (o & 2);
+    int row = (o & 2) ? h - 1 - lz : lz;
+    int col = (o & 1) ? w - 1 - lx : lx;
+    int cellSlot = run->axis == 0 ? row * w + col + (otherFirst ? 0 : 1)
+                                  : (row + (otherFirst ? 0 : 1)) * w;
+    int slot = 0;
+    while (slot < chunk->runCount && chunk->runKeys[o][slot] < cellSlot) slot++;
+    return slot;
+}
 
-    // horizontal edges between (x,z) and (x+1,z)
-    for (int z = 0; z < MAP_H; z++) {
-        for (int x = 0; x < MAP_W - 1; x++) {
-            if (faceCount >= (int)(sizeof(faces)/sizeof(faces[0]))) break;
+// Hands every wall to the chunk of the tile on its -x/-z side and to each
+// LOD chunk above it, in each chunk's orders by wallSlot.
+static void buildChunkWalls(void) {
+    for (int c = 0; c < chunkCount; c++) chunks[c].detailWallCount = 0;
+
+    // unit walls just group by chunk
+    for (int i = 0; i < wallTileCount; i++) {
+        chunks[chunkOfTile(wallTileRuns[i].x, wallTileRuns[i].z)].detailWallCount++;
+    }
+    int detailStart = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        chunks[c].detailWalls = &chunkDetailWalls[detailStart];
+        detailStart += chunks[c].detailWallCount;
+        chunks[c].detailWallCount = 0;
+    }
+    for (int i = 0; i < wallTileCount; i++) {
+        TerrainChunk *chunk = &chunks[chunkOfTile(wallTileRuns[i].x, wallTileRuns[i].z)];
+        chunkDetailWalls[(chunk->detailWalls - chunkDetailWalls) + chunk->detailWallCount++] = i;
+    }
+
+    free(chunkWallStorage);
+    chunkWallStorage = NULL;
+    for (int n = 0; n < terrainNodeCount; n++) terrainNodes[n].chunk->wallCount = 0;
+    for (int i = 0; i < faceCount; i++) {
+        for (int n = chunkOfTile(wallRuns[i].x, wallRuns[i].z); n >= 0; n = terrainNodes[n].parent) {
+            terrainNodes[n].chunk->wallCount++;
+        }
+    }
+
+    int total = 0;
+    for (int n = 0; n < terrainNodeCount; n++) total += terrainNodes[n].chunk->wallCount;
+    int *first = malloc((size_t)(terrainNodeCount > 0 ? terrainNodeCount : 1) * sizeof(int));
+    chunkWallStorage = malloc((size_t)(total > 0 ? total : 1) * 8 * sizeof(int));
+    if (!first || !chunkWallStorage) {
+        free(first);
+        free(chunkWallStorage);
+        chunkWallStorage = NULL;
+        for (int n = 0; n < terrainNodeCount; n++) terrainNodes[n].chunk->wallCount = 0;
+        gIncomplete = 1;
+        return;
+    }
+
+    int start = 0;
+    for (int n = 0; n < terrainNodeCount; n++) {
+        TerrainChunk *chunk = terrainNodes[n].chunk;
+        first[n] = start;
+        for (int o = 0; o < 4; o++) {
+            chunk->walls[o] = &chunkWallStorage[start + o * chunk->wallCount];
+            chunk->wallSlots[o] = &chunkWallStorage[start + (4 + o) * chunk->wallCount];
+        }
+        start += chunk->wallCount * 8;
+        chunk->wallCount = 0;
+    }
+
+    for (int i = 0; i < faceCount; i++) {
+        const WallRun *run = &wallRuns[i];
+        for (int n = chunkOfTile(run->x, run->z); n >= 0; n = terrainNodes[n].parent) {
+            TerrainChunk *chunk = terrainNodes[n].chunk;
+            int k = chunk->wallCount++;
+            for (int o = 0; o < 4; o++) {
+                int slot = wallSlot(chunk, run, o);
+                // insertion sort by slot; chunks hold few walls
+                int *list = &chunkWallStorage[first[n]] + (chunk->walls[o] - chunk->walls[0]);
+                int *slots = &chunkWallStorage[first[n]] + (chunk->wallSlots[o] - chunk->walls[0]);
+                int j = k;
+                while (j > 0 && slots[j - 1] > slot) {
+                    list[j] = list[j - 1];
+                    slots[j] = slots[j - 1];
+                    j--;
+                }
+                list[j] = i;
+                slots[j] = slot;
+            }
+        }
+    }
+    free(first);
+}
+
+// Grows each chunk's bounds and its node's box over the walls it draws:
+// cliff tiles sit at their lowest corner, so the mesh alone stops short
+// of the wall tops, and map-edge walls lie past the last tile.
+static void fitChunkBounds(void) {
+    for (int n = 0; n < terrainNodeCount; n++) {
+        TerrainNode *node = &terrainNodes[n];
+        TerrainChunk *chunk = node->chunk;
+        for (int w = 0; w < chunk->wallCount; w++) {
+            const MeshInstance *wall = &faces[chunk->walls[0][w]];
+            render3dInstanceExtendBounds(&chunk->inst, wall->worldMin, wall->worldMax);
+        }
+        node->min = v3(fminf(node->min.x, chunk->inst.worldMin.x), fminf(node->min.y, chunk->inst.worldMin.y),
+                       fminf(node->min.z, chunk->inst.worldMin.z));
+        node->max = v3(fmaxf(node->max.x, chunk->inst.worldMax.x), fmaxf(node->max.y, chunk->inst.worldMax.y),
+                       fmaxf(node->max.z, chunk->inst.worldMax.z));
+    }
+}
+
+// Tile edges with a big enough height jump for a wall; every wall run
+// covers at least one, so this bounds both wall buffers.
+static int countWallEdges(void) {
+    int count = 0;
+    for (int z = 0; z < levelInfo.height; z++) {
+        for (int x = 0; x < levelInfo.width; x++) {
+            int h = tileHeight(x, z);
+            if (x < levelInfo.tilesX && iabs_int(tileHeight(x + 1, z) - h) >= WALL_DIFF_THRESHOLD) count++;
+            if (z < levelInfo.tilesZ && iabs_int(tileHeight(x, z + 1) - h) >= WALL_DIFF_THRESHOLD) count++;
+        }
+    }
+    return count;
+}
+
+// Everything over the finished chunk rows: LOD levels and walls.
+static void buildLevelGeometry(void) {
+    faceCount = 0;
+    wallTileCount = 0;
+
+    SDL_Color wallColorPos = (SDL_Color){220, 220, 240, 255};
+    SDL_Color wallColorNeg = (SDL_Color){140, 140, 170, 255};
+
+    // 1) the heightfield chunks and the LOD levels over them
+    finishTerrainChunks();
+    linkTerrainLod();
+
+    // 2) vertical walls where height diff >= 4 between neighbors, in
+    // buffers sized to the tile edges that have one
+    wallCapacity = countWallEdges();
+    size_t walls = (size_t)(wallCapacity > 0 ? wallCapacity : 1);
+    wallRuns = malloc(walls * sizeof(WallRun));
+    wallTileRuns = malloc(walls * sizeof(WallRun));
+    chunkDetailWalls = malloc(walls * sizeof(int));
+    if (!wallRuns || !wallTileRuns || !chunkDetailWalls) {
+        printf("Failed to allocate %d walls\n", wallCapacity);
+        gIncomplete = 1;
+        wallCapacity = 0;
+    }
 
+    // horizontal edges between (x,z) and (x+1,z)
+    for (int z = 0; z < levelInfo.height; z++) {
+        for (int x = 0; x < levelInfo.tilesX; x++) {
             int hA = tileHeight(x,     z);
             int hB = tileHeight(x + 1, z);
             int diff = hB - hA;
             if (iabs_int(diff) < WALL_DIFF_THRESHOLD) continue;
 
-            float fx = (x + 1) * TILE_SIZE;   // edge at x+1
-            float fz = z * TILE_SIZE;
-
-            float yLow  = (diff > 0 ? hA : hB) * WALL_HEIGHT;
-            float yHigh = (diff > 0 ? hB : hA) * WALL_HEIGHT;
-
-            SDL_Color col = diff > 0 ? wallColorPos : wallColorNeg;
-
-            // vertical wall quad along z
-            render3dInitQuadMesh(&faces[faceCount++],
-                v3(fx, yLow,  fz),
-                v3(fx, yLow,  fz+TILE_SIZE),
-                v3(fx, yHigh, fz+TILE_SIZE),
-                v3(fx, yHigh, fz),
-                col);
+            // vertical wall quad along z at x+1, facing the lower tile
+            addWall((WallRun){
+                x, z, 0, 1,
+                diff > 0 ? hA : hB, diff > 0 ? hB : hA,
+                diff > 0,
+                diff > 0 ? wallColorPos : wallColorNeg,
+            });
         }
     }
 
     // vertical edges between (x,z) and (x,z+1)
-    for (int z = 0; z < MAP_H - 1; z++) {
-        for (int x = 0; x < MAP_W; x++) {
-            if (faceCount >= (int)(sizeof(faces)/sizeof(faces[0]))) break;
-
+    for (int z = 0; z < levelInfo.tilesZ; z++) {
+        for (int x = 0; x < levelInfo.width; x++) {
             int hA = tileHeight(x, z);
             int hB = tileHeight(x, z + 1);
             int diff = hB - hA;
             if (iabs_int(diff) < WALL_DIFF_THRESHOLD) continue;
 
-            float fx = x * TILE_SIZE;
-            float fz = (z + 1) * TILE_SIZE;  // edge at z+1
-
-            float yLow  = (diff > 0 ? hA : hB) * WALL_HEIGHT;
-            float yHigh = (diff > 0 ? hB : hA) * WALL_HEIGHT;
+            // vertical wall quad along x at z+1, facing the lower tile
+            addWall((WallRun){
+                x, z, 1, 1,
+                diff > 0 ? hA : hB, diff > 0 ? hB : hA,
+                diff < 0,
+                diff > 0 ? wallColorPos : wallColorNeg,
+            });
+        }
+    }
 
-            SDL_Color col = diff > 0 ? wallColorPos : wallColorNeg;
+    // Instances once the runs are known: merged runs need fewer than
+    // there are edges. Their meshes point into themselves, so they are
+    // never moved after this.
+    WallRun *shrunk = realloc(wallRuns, (size_t)(faceCount > 0 ? faceCount : 1) * sizeof(WallRun));
+    if (shrunk) wallRuns = shrunk;
+    faces = malloc((size_t)(faceCount > 0 ? faceCount : 1) * sizeof(MeshInstance));
+    wallTiles = malloc((size_t)(wallTileCount > 0 ? wallTileCount : 1) * sizeof(MeshInstance));
+    if (!faces || !wallTiles) {
+        printf("Failed to allocate %d walls\n", faceCount + wallTileCount);
+        gIncomplete = 1;
+        faceCount = wallTileCount = 0;
+    }
+    for (int i = 0; i < faceCount; i++) buildWallQuad(&faces[i], &wallRuns[i]);
+    for (int i = 0; i < wallTileCount; i++) buildWallQuad(&wallTiles[i], &wallTileRuns[i]);
+
+    buildChunkWalls();
+    fitChunkBounds();
+
+    int runTris = 0;
+    for (int c = 0; c < chunkCount; c++) runTris += chunks[c].inst.mesh.indexCount / 3;
+    printf("level: %d terrain + %d wall quads merged into %d + %d faces (%d -> %d triangles)\n",
+           terrainTileCount, wallTileCount, terrainRunCount, faceCount,
+           (terrainTileCount + wallTileCount) * 2, runTris + faceCount * 2);
+    printf("level: %d LOD chunks over %d chunks\n", lodChunkCount, chunkCount);
+}
 
-            // vertical wall quad along x
-            render3dInitQuadMesh(&faces[faceCount++],
-                v3(fx,           yLow,  fz),
-                v3(fx+TILE_SIZE, yLow,  fz),
-                v3(fx+TILE_SIZE, yHigh, fz),
-                v3(fx,           yHigh, fz),
-                col);
+// Cliff tiles are flattened to their lowest corner, which leaves gaps
+// along their edges; the floor shows through them within this many cells.
+#define FLOOR_CLIFF_MARGIN 1
+
+// 1 where the floor at y=0 can show: past the last terrain row/column,
+// under tiles that dip below it (the pit, deep noise) and around cliffs.
+static int floorUncovered(int x, int z) {
+    if (x >= levelInfo.tilesX || z >= levelInfo.tilesZ) return 1;
+    int h[4];
+    terrainTileHeights(x, z, h);
+    if (imin4(h[0], h[1], h[2], h[3]) < 0) return 1;
+    for (int dz = -FLOOR_CLIFF_MARGIN; dz <= FLOOR_CLIFF_MARGIN; dz++) {
+        for (int dx = -FLOOR_CLIFF_MARGIN; dx <= FLOOR_CLIFF_MARGIN; dx++) {
+            int nx = x + dx, nz = z + dz;
+            if (nx < 0 || nz < 0 || nx >= levelInfo.tilesX || nz >= levelInfo.tilesZ) continue;
+            if (terrainTileHeights(nx, nz, h)) return 1;
         }
     }
+    return 0;
 }
 
-// flat floor at y=0 for now (optional, mostly hidden by terrain)
-static void buildFloorGeometry(void) {
+// A merged floor rectangle of w x h cells inside the block at (bx, bz).
+typedef struct {
+    int x, z, w, h;
+    int bx, bz;
+} FloorRect;
+
+// floorFaces[] as rectangles, for the level cache
+static FloorRect *floorRects = NULL;
+static int floorRectCount = 0;
+
+// Rows z0 to z1 - 1 of the uncovered cell mask, width x height cells.
+static void floorOpenRows(unsigned char *open, int z0, int z1) {
+    for (int z = z0; z < z1; z++) {
+        for (int x = 0; x < levelInfo.width; x++) open[z * levelInfo.width + x] = (unsigned char)floorUncovered(x, z);
+    }
+}
+
+// One quad per floorRects[] entry.
+static void buildFloorQuads(void) {
     floorCount = 0;
 
     SDL_Color floorColor = gGrassTexture ?
         (SDL_Color){255, 255, 255, 255} :
         (SDL_Color){70, 90, 110, 255};
-    float tileScale = 1.0f;
-
-    for (int z = 0; z < MAP_H; z++) {
-        for (int x = 0; x < MAP_W; x++) {
-            Vec3 f0 = v3(x * TILE_SIZE,          0, z * TILE_SIZE);
-            Vec3 f1 = v3((x + 1) * TILE_SIZE,    0, z * TILE_SIZE);
-            Vec3 f2 = v3((x + 1) * TILE_SIZE,    0, (z + 1) * TILE_SIZE);
-            Vec3 f3 = v3(x * TILE_SIZE,          0, (z + 1) * TILE_SIZE);
-
-            SDL_FPoint uv0 = {0.0f,      0.0f};
-            SDL_FPoint uv1 = {tileScale, 0.0f};
-            SDL_FPoint uv2 = {tileScale, tileScale};
-            SDL_FPoint uv3 = {0.0f,      tileScale};
-
-            if (floorCount < (int)(sizeof(floorFaces)/sizeof(floorFaces[0]))) {
-                render3dInitQuadMeshUV(&floorFaces[floorCount++],
-                    f0, f1, f2, f3, floorColor,
-                    uv0, uv1, uv2, uv3);
-
-                if (floorCount > 0) {
-                    floorFaces[floorCount - 1].mesh.texture = gGrassTexture;
+    float tileScale = 1.0f / (float)CHUNK_TILES;
+
+    floorFaces = malloc((size_t)(floorRectCount > 0 ? floorRectCount : 1) * sizeof(MeshInstance));
+    if (!floorFaces) {
+        printf("Failed to allocate %d floor quads\n", floorRectCount);
+        gIncomplete = 1;
+        return;
+    }
+    for (int i = 0; i < floorRectCount; i++) {
+        const FloorRect *r = &floorRects[i];
+        Vec3 f0 = v3(r->x * TILE_SIZE,          0, r->z * TILE_SIZE);
+        Vec3 f1 = v3((r->x + r->w) * TILE_SIZE, 0, r->z * TILE_SIZE);
+        Vec3 f2 = v3((r->x + r->w) * TILE_SIZE, 0, (r->z + r->h) * TILE_SIZE);
+        Vec3 f3 = v3(r->x * TILE_SIZE,          0, (r->z + r->h) * TILE_SIZE);
+
+        float u0 = (float)(r->x - r->bx) * tileScale, u1 = (float)(r->x + r->w - r->bx) * tileScale;
+        float t0 = (float)(r->z - r->bz) * tileScale, t1 = (float)(r->z + r->h - r->bz) * tileScale;
+        SDL_FPoint uv0 = {u0, t0};
+        SDL_FPoint uv1 = {u1, t0};
+        SDL_FPoint uv2 = {u1, t1};
+        SDL_FPoint uv3 = {u0, t1};
+
+        MeshInstance *face = &floorFaces[floorCount++];
+        render3dInitQuadMeshUV(face, f0, f1, f2, f3, floorColor, uv0, uv1, uv2, uv3);
+        face->mesh.texture = gGrassTexture;
+        face->mesh.cullMode = RENDER3D_CULL_BACK;
+    }
+}
+
+// flat floor at y=0, only where the terrain doesn't cover it. Uncovered
+// cells are merged greedily into rectangles within chunk-sized blocks, so
+// their chunk-local UVs stay inside the repeated grass texture. Takes the
+// mask from floorOpenRows, or NULL when there is none, and frees it.
+static void buildFloorGeometry(unsigned char *open) {
+    floorCount = 0;
+    floorRectCount = 0;
+
+    int mapW = levelInfo.width, mapH = levelInfo.height;
+    if (!open) {
+        printf("Failed to allocate floor cells\n");
+        gIncomplete = 1;
+        return;
+    }
+    int openCount = 0;
+    for (int i = 0; i < mapW * mapH; i++) openCount += open[i];
+
+    // merged rectangles first, at most one per cell, so the instances
+    // can be allocated at their final count
+    FloorRect *rects = malloc((size_t)(openCount > 0 ? openCount : 1) * sizeof(FloorRect));
+    if (!rects) {
+        printf("Failed to allocate %d floor cells\n", openCount);
+        gIncomplete = 1;
+        free(open);
+        return;
+    }
+    int rectCount = 0;
+    for (int bz = 0; bz < mapH; bz += CHUNK_TILES) {
+        for (int bx = 0; bx < mapW; bx += CHUNK_TILES) {
+            int ex = bx + CHUNK_TILES < mapW ? bx + CHUNK_TILES : mapW;
+            int ez = bz + CHUNK_TILES < mapH ? bz + CHUNK_TILES : mapH;
+            for (int z = bz; z < ez; z++) {
+                for (int x = bx; x < ex; x++) {
+                    if (!open[z * mapW + x]) continue;
+
+                    // widest run along x, then as many rows as match it
+                    int w = 1, h = 1;
+                    while (x + w < ex && open[z * mapW + x + w]) w++;
+                    for (; z + h < ez; h++) {
+                        int full = 1;
+                        for (int k = 0; k < w && full; k++) full = open[(z + h) * mapW + x + k];
+                        if (!full) break;
+                    }
+                    for (int dz = 0; dz < h; dz++) {
+                        for (int dx = 0; dx < w; dx++) open[(z + dz) * mapW + x + dx] = 0;
+                    }
+                    rects[rectCount++] = (FloorRect){x, z, w, h, bx, bz};
                 }
             }
         }
     }
+    free(open);
+
+    FloorRect *shrunk = realloc(rects, (size_t)(rectCount > 0 ? rectCount : 1) * sizeof(FloorRect));
+    floorRects = shrunk ? shrunk : rects;
+    floorRectCount = rectCount;
+    buildFloorQuads();
+
+    printf("level: %d floor cells uncovered by terrain, merged into %d quads\n", openCount, floorCount);
+}
+
+// -------------------------------------------------------------
+// Build pipeline
+// -------------------------------------------------------------
+
+#define LEVEL_MAX_THREADS 8
+
+enum { BUILD_NONE, BUILD_BAKE, BUILD_BAND, BUILD_ROW, BUILD_LOD };
+
+// The heightmap is generated in bands of CHUNK_TILES rows, one per chunk
+// row; the last band also takes the final row of corners. A chunk row,
+// with its leaf nodes and the floor cells over the same rows, is built
+// once its band and both neighbours are done, and the LOD chunks, which
+// span many bands, once all of them are. The calling thread and helpers
+// all take the next task that is ready: the grass bake, a chunk row, the
+// next band, then a LOD chunk. lock is NULL when the calling thread works
+// alone.
+typedef struct {
+    SDL_mutex *lock;
+    SDL_cond *ready;
+    int bands;
+    int nextBand;
+    unsigned char *bandDone;
+    unsigned char *rowTaken;
+    int rowsTaken;
+    int bandsDone;
+    int lods;
+    int nextLod;
+    int bakeWanted;
+    SDL_Surface *grass;
+    float *noise;          // map-sized bump noise, or NULL
+    unsigned char *open;   // floor mask, or NULL
+} LevelBuild;
+
+static LevelBuild gBuild;
+
+static void bandRows(int b, int *z0, int *z1) {
+    *z0 = b * CHUNK_TILES;
+    *z1 = b == gBuild.bands - 1 ? levelInfo.height : *z0 + CHUNK_TILES;
+}
+
+static int rowReady(int cz) {
+    int lo = cz > 0 ? cz - 1 : 0;
+    int hi = cz + 1 < gBuild.bands ? cz + 1 : gBuild.bands - 1;
+    for (int b = lo; b <= hi; b++) {
+        if (!gBuild.bandDone[b]) return 0;
+    }
+    return 1;
+}
+
+// Holding the lock: waits until a task is ready or none are left.
+static int takeTask(int *index) {
+    for (;;) {
+        if (gBuild.bakeWanted) {
+            gBuild.bakeWanted = 0;
+            return BUILD_BAKE;
+        }
+        if (gBuild.rowsTaken == gBuild.bands && gBuild.nextLod == gBuild.lods) return BUILD_NONE;
+        for (int cz = 0; cz < gBuild.bands; cz++) {
+            if (gBuild.rowTaken[cz] || !rowReady(cz)) continue;
+            gBuild.rowTaken[cz] = 1;
+            gBuild.rowsTaken++;
+            *index = cz;
+            return BUILD_ROW;
+        }
+        if (gBuild.nextBand < gBuild.bands) {
+            *index = gBuild.nextBand++;
+            return BUILD_BAND;
+        }
+        if (gBuild.bandsDone == gBuild.bands && gBuild.nextLod < gBuild.lods) {
+            *index = gBuild.nextLod++;
+            return BUILD_LOD;
+        }
+        // every band is out and what is left waits on some of them
+        if (!gBuild.lock) return BUILD_NONE;
+        SDL_CondWait(gBuild.ready, gBuild.lock);
+    }
+}
+
+static void runTask(int task, int index) {
+    int z0, z1;
+    switch (task) {
+    case BUILD_BAKE:
+        gBuild.grass = bakeGrass();
+        break;
+    case BUILD_BAND:
+        bandRows(index, &z0, &z1);
+        generateRows(z0, z1, gBuild.noise);
+        break;
+    case BUILD_ROW:
+        buildChunkRow(index);
+        for (int cx = 0; cx < levelInfo.chunksX && terrainNodes; cx++) buildLeafNode(index * levelInfo.chunksX + cx);
+        bandRows(index, &z0, &z1);
+        if (gBuild.open) floorOpenRows(gBuild.open, z0, z1);
+        break;
+    case BUILD_LOD:
+        buildLodTask(index);
+        break;
+    }
+}
+
+static int buildMain(void *data) {
+    (void)data;
+    if (gBuild.lock) SDL_LockMutex(gBuild.lock);
+    for (;;) {
+        int index = 0;
+        int task = takeTask(&index);
+        if (task == BUILD_NONE) break;
+        if (gBuild.lock) SDL_UnlockMutex(gBuild.lock);
+        runTask(task, index);
+        if (gBuild.lock) SDL_LockMutex(gBuild.lock);
+        if (task == BUILD_BAND) {
+            gBuild.bandDone[index] = 1;
+            gBuild.bandsDone++;
+        }
+        if (gBuild.ready) SDL_CondBroadcast(gBuild.ready);
+    }
+    if (gBuild.lock) SDL_UnlockMutex(gBuild.lock);
+    return 0;
+}
+
+static int wantedThreads(void) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 1;
+#else
+    int count = SDL_GetCPUCount();
+    if (count < 1) count = 1;
+    if (count > LEVEL_MAX_THREADS) count = LEVEL_MAX_THREADS;
+    return count;
+#endif
+}
+
+// Runs bands heightmap bands, their chunk rows and the LOD chunks, plus the
+// grass bake when there is no texture yet, on every core. Hands back the
+// baked grass for the calling thread to upload; 0 when out of memory for
+// the bands.
+static int runBuild(int bands, float *noise, unsigned char *open, SDL_Surface **grass) {
+    unsigned char *flags = calloc((size_t)(bands > 0 ? bands : 1) * 2, 1);
+    int ok = flags != NULL;
+    if (!ok) {
+        printf("Failed to allocate %d level bands\n", bands);
+        bands = 0;
+    }
+    gBuild = (LevelBuild){0};
+    gBuild.bands = bands;
+    gBuild.lods = ok ? lodChunkCount : 0;
+    gBuild.bandDone = flags;
+    gBuild.rowTaken = flags ? flags + bands : NULL;
+    gBuild.bakeWanted = !gGrassTexture;
+    gBuild.noise = noise;
+    gBuild.open = open;
+
+    int helpers = wantedThreads() - 1;
+    if (helpers > bands * 2 + gBuild.lods) helpers = bands * 2 + gBuild.lods;
+    SDL_Thread *threads[LEVEL_MAX_THREADS];
+    int threadCount = 0;
+    if (helpers > 0) {
+        gBuild.lock = SDL_CreateMutex();
+        gBuild.ready = SDL_CreateCond();
+        if (!gBuild.lock || !gBuild.ready) {
+            if (gBuild.lock) SDL_DestroyMutex(gBuild.lock);
+            if (gBuild.ready) SDL_DestroyCond(gBuild.ready);
+            gBuild.lock = NULL;
+            gBuild.ready = NULL;
+            helpers = 0;
+        }
+    }
+    while (threadCount < helpers) {
+        SDL_Thread *thread = SDL_CreateThread(buildMain, "level", NULL);
+        if (!thread) break;
+        threads[threadCount++] = thread;
+    }
+    buildMain(NULL);
+    for (int i = 0; i < threadCount; i++) SDL_WaitThread(threads[i], NULL);
+
+    if (gBuild.lock) SDL_DestroyMutex(gBuild.lock);
+    if (gBuild.ready) SDL_DestroyCond(gBuild.ready);
+    free(flags);
+    *grass = gBuild.grass;
+    gBuild = (LevelBuild){0};
+    return ok;
+}
+
+// -------------------------------------------------------------
+// Level cache: the built level as one levelcache.h file
+// -------------------------------------------------------------
+
+// Part of the cache key; bump when generation or the cached layout
+// changes.
+#define LEVEL_GENERATOR_VERSION 1
+
+enum {
+    CACHE_LEVEL,           // one CachedLevel
+    CACHE_HEIGHTS,
+    CACHE_CHUNKS,          // CachedChunk per node, leaves then LOD
+    CACHE_NODES,           // CachedNode per node
+    CACHE_VERTS,           // every chunk's runs, packed chunk after chunk
+    CACHE_UVS,
+    CACHE_INDICES,         // each chunk's four orders back to back
+    CACHE_RUN_KEYS,
+    CACHE_RUN_STARTS,
+    CACHE_DETAIL_VERTS,    // the detail buffers as built
+    CACHE_DETAIL_UVS,
+    CACHE_DETAIL_INDICES,
+    CACHE_WALL_RUNS,
+    CACHE_WALL_TILE_RUNS,
+    CACHE_WALL_LISTS,      // chunkWallStorage
+    CACHE_DETAIL_WALLS,
+    CACHE_FLOOR_RECTS,
+    CACHE_GRASS,           // grassH rows of grassW RGBA32 texels
+    CACHE_SECTIONS
+};
+
+typedef struct {
+    int width, height;
+    int chunkCount, lodChunkCount;
+    int faceCount, wallTileCount;
+    int floorRectCount;
+    int grassW, grassH;
+} CachedLevel;
+
+// A terrain chunk with its pointers as offsets into the sections.
+typedef struct {
+    int level;
+    int tileX, tileZ, tilesX, tilesZ;
+    int runCount;
+    int firstVert, vertCount;
+    int firstIndex, indexCount;     // indexCount per order
+    int firstRun;                   // runCount + 1 keys and starts per order
+    int firstDetail;                // leaves: first tile in the detail buffers
+    int firstWall, wallCount;       // wall lists then slots, per order
+    int firstDetailWall, detailWallCount;
+} CachedChunk;
+
+typedef struct {
+    int level, parent;
+    int children[4];
+    float error;
+    Vec3 min, max;
+} CachedNode;
+
+// The file a loaded level's arrays point into, or NULL when they are
+// all on the heap.
+static LevelCache *gCache = NULL;
+
+static Uint64 cacheKey(int width, int height) {
+    int params[] = {
+        LEVEL_GENERATOR_VERSION, width, height, CHUNK_TILES, GRASS_TEX_SIZE, WALL_DIFF_THRESHOLD,
+        (int)sizeof(CachedChunk), (int)sizeof(CachedNode), (int)sizeof(WallRun), (int)sizeof(FloorRect),
+    };
+    float scales[] = {TILE_SIZE, WALL_HEIGHT};
+    Uint64 key = levelCacheHash(LEVELCACHE_HASH_SEED, params, sizeof params);
+    key = levelCacheHash(key, scales, sizeof scales);
+    // every fnl_state field is 4 bytes, so there is no padding to hash
+    return levelCacheHash(key, &gNoise, sizeof gNoise);
+}
+
+static TerrainChunk *nodeChunk(int n) {
+    return n < chunkCount ? &chunks[n] : &lodChunks[n - chunkCount];
+}
+
+static void appendSection(LevelCacheWriter *w, const void *data, size_t size) {
+    levelCacheBeginSection(w);
+    levelCacheAppend(w, data, size);
+}
+
+// Writes the level just built, unless it went without anything.
+static void saveLevelCache(Uint64 key) {
+    if (gIncomplete || !terrainNodes || !gGrassSurface) return;
+    int total = chunkCount + lodChunkCount;
+    CachedChunk *records = malloc((size_t)total * sizeof(CachedChunk));
+    CachedNode *nodes = malloc((size_t)total * sizeof(CachedNode));
+    LevelCacheWriter *w = records && nodes ? levelCacheCreate(key) : NULL;
+    if (!w) {
+        free(records);
+        free(nodes);
+        return;
+    }
+
+    // merged runs are packed: chunks leave most of their ranges unused
+    int verts = 0, indices = 0, runs = 0, wallInts = 0;
+    for (int n = 0; n < total; n++) {
+        const TerrainChunk *c = nodeChunk(n);
+        const TerrainNode *node = &terrainNodes[n];
+        records[n] = (CachedChunk){
+            c->level, c->tileX, c->tileZ, c->tilesX, c->tilesZ, c->runCount,
+            verts, c->inst.mesh.vertCount,
+            indices, c->inst.mesh.indexCount,
+            runs,
+            c->level == 0 ? (int)(c->detail.verts - detailVerts) / 4 : 0,
+            c->wallCount > 0 ? (int)(c->walls[0] - chunkWallStorage) : 0, c->wallCount,
+            c->detailWallCount > 0 ? (int)(c->detailWalls - chunkDetailWalls) : 0, c->detailWallCount,
+        };
+        verts += c->inst.mesh.vertCount;
+        indices += c->inst.mesh.indexCount * 4;
+        runs += (c->runCount + 1) * 4;
+        wallInts += c->wallCount * 8;
+        nodes[n] = (CachedNode){
+            node->level, node->parent,
+            {node->children[0], node->children[1], node->children[2], node->children[3]},
+            node->error, node->min, node->max,
+        };
+    }
+
+    CachedLevel info = {
+        levelInfo.width, levelInfo.height, chunkCount, lodChunkCount,
+        faceCount, wallTileCount, floorRectCount, gGrassSurface->w, gGrassSurface->h,
+    };
+    size_t tiles = (size_t)levelInfo.tilesX * (size_t)levelInfo.tilesZ;
+    appendSection(w, &info, sizeof info);
+    appendSection(w, heightmap, (size_t)levelInfo.width * (size_t)levelInfo.height * sizeof(int));
+    appendSection(w, records, (size_t)total * sizeof(CachedChunk));
+    appendSection(w, nodes, (size_t)total * sizeof(CachedNode));
+    levelCacheBeginSection(w);
+    for (int n = 0; n < total; n++) {
+        const Mesh *m = &nodeChunk(n)->inst.mesh;
+        levelCacheAppend(w, m->verts, (size_t)m->vertCount * sizeof(Vec3));
+    }
+    levelCacheBeginSection(w);
+    for (int n = 0; n < total; n++) {
+        const Mesh *m = &nodeChunk(n)->inst.mesh;
+        levelCacheAppend(w, m->uvs, (size_t)m->vertCount * sizeof(SDL_FPoint));
+    }
+    levelCacheBeginSection(w);
+    for (int n = 0; n < total; n++) {
+        const TerrainChunk *c = nodeChunk(n);
+        levelCacheAppend(w, c->orders[0], (size_t)c->inst.mesh.indexCount * 4 * sizeof(int));
+    }
+    levelCacheBeginSection(w);
+    for (int n = 0; n < total; n++) {
+        const TerrainChunk *c = nodeChunk(n);
+        levelCacheAppend(w, c->runKeys[0], (size_t)(c->runCount + 1) * 4 * sizeof(int));
+    }
+    levelCacheBeginSection(w);
+    for (int n = 0; n < total; n++) {
+        const TerrainChunk *c = nodeChunk(n);
+        levelCacheAppend(w, c->runStarts[0], (size_t)(c->runCount + 1) * 4 * sizeof(int));
+    }
+    appendSection(w, detailVerts, tiles * 4 * sizeof(Vec3));
+    appendSection(w, detailUVs, tiles * 4 * sizeof(SDL_FPoint));
+    appendSection(w, detailIndices, tiles * 6 * sizeof(int));
+    appendSection(w, wallRuns, (size_t)faceCount * sizeof(WallRun));
+    appendSection(w, wallTileRuns, (size_t)wallTileCount * sizeof(WallRun));
+    appendSection(w, chunkWallStorage, (size_t)wallInts * sizeof(int));
+    appendSection(w, chunkDetailWalls, (size_t)wallTileCount * sizeof(int));
+    appendSection(w, floorRects, (size_t)floorRectCount * sizeof(FloorRect));
+    levelCacheBeginSection(w);
+    for (int y = 0; y < gGrassSurface->h; y++) {
+        levelCacheAppend(w, (const Uint8 *)gGrassSurface->pixels + y * gGrassSurface->pitch,
+                         (size_t)gGrassSurface->w * 4);
+    }
+    free(records);
+    free(nodes);
+
+    if (!levelCacheFinish(w)) printf("Failed to write the level cache\n");
+}
+
+// Section i as count items of size bytes, or NULL when it holds another
+// amount.
+static void *cacheArray(int i, size_t count, size_t size) {
+    size_t bytes;
+    void *data = levelCacheSection(gCache, i, &bytes);
+    return data && bytes == count * size ? data : NULL;
+}
+
+// Section i as whole items of size bytes, counted in *count.
+static void *cacheItems(int i, size_t size, int *count) {
+    size_t bytes;
+    void *data = levelCacheSection(gCache, i, &bytes);
+    *count = 0;
+    if (!data || bytes % size != 0 || bytes / size > INT_MAX) return NULL;
+    *count = (int)(bytes / size);
+    return data;
+}
+
+// count blocks of per items from first fit in total items.
+static int inRange(int first, int count, int per, int total) {
+    return first >= 0 && count >= 0 && first <= total && count <= (total - first) / per;
+}
+
+// count ints from values, each in [0, limit).
+static int allBelow(const int *values, int count, int limit) {
+    for (int i = 0; i < count; i++) {
+        if (values[i] < 0 || values[i] >= limit) return 0;
+    }
+    return 1;
+}
+
+// Whether what the loaded chunks hold stays inside the arrays it indexes
+// (vertices, runs, walls) and the nodes form a tree: every child comes
+// before its parent and names it, up to the root at the end. Parent walks
+// and the LOD descent then always end.
+static int cachedChunksValid(int wallCount, int wallTileCount) {
+    for (int n = 0; n < terrainNodeCount; n++) {
+        const TerrainNode *node = &terrainNodes[n];
+        const TerrainChunk *c = node->chunk;
+        int leaf = n < chunkCount;
+        // LOD levels shift CHUNK_TILES, so keep them well short of overflow
+        if (leaf != (node->level == 0) || node->level < 0 || node->level > 16) return 0;
+        if (n == terrainNodeCount - 1 ? node->parent != -1 : node->parent <= n) return 0;
+        for (int k = 0; k < 4; k++) {
+            int child = node->children[k];
+            if (child != -1 && (child >= n || terrainNodes[child].parent != n)) return 0;
+        }
+
+        int indexCount = c->inst.mesh.indexCount, runCount = c->runCount;
+        if (runCount < 0 || !allBelow(c->orders[0], indexCount * 4, c->inst.mesh.vertCount)) return 0;
+        for (int o = 0; o < 4; o++) {
+            const int *starts = c->runStarts[o];
+            if (starts[0] != 0 || starts[runCount] != indexCount) return 0;
+            for (int i = 0; i < runCount; i++) {
+                if (starts[i] > starts[i + 1]) return 0;
+            }
+            if (!allBelow(c->walls[o], c->wallCount, wallCount) ||
+                !allBelow(c->wallSlots[o], c->wallCount, runCount + 1)) {
+                return 0;
+            }
+        }
+        if (leaf && (!allBelow(c->detail.indices, c->detail.indexCount, c->detail.vertCount) ||
+                     !allBelow(c->detailWalls, c->detailWallCount, wallTileCount))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Points the level's arrays into cache and rebuilds what holds pointers:
+// the chunks, the tree and the wall and floor instances. The file is
+// trusted once the offsets in it, the indices in its chunks and the shape
+// of its tree check out. 0 when they don't; freeLevel then drops whatever
+// was set up.
+static int loadLevelCache(LevelCache *cache, int width, int height) {
+    gCache = cache;
+    const CachedLevel *info = cacheArray(CACHE_LEVEL, 1, sizeof(CachedLevel));
+    if (!info || info->width != width || info->height != height) return 0;
+    setLevelSize(width, height);
+    if (info->chunkCount != levelInfo.chunksX * levelInfo.chunksZ || info->lodChunkCount < 0 ||
+        info->faceCount < 0 || info->wallTileCount < 0 || info->floorRectCount < 0 ||
+        info->grassW <= 0 || info->grassH <= 0) {
+        return 0;
+    }
+
+    int total = info->chunkCount + info->lodChunkCount;
+    int tiles = levelInfo.tilesX * levelInfo.tilesZ;
+    int vertTotal, indexTotal, runTotal, wallInts;
+    heightmap = cacheArray(CACHE_HEIGHTS, (size_t)width * (size_t)height, sizeof(int));
+    const CachedChunk *records = cacheArray(CACHE_CHUNKS, (size_t)total, sizeof(CachedChunk));
+    const CachedNode *nodes = cacheArray(CACHE_NODES, (size_t)total, sizeof(CachedNode));
+    terrainVerts = cacheItems(CACHE_VERTS, sizeof(Vec3), &vertTotal);
+    terrainUVs = cacheArray(CACHE_UVS, (size_t)vertTotal, sizeof(SDL_FPoint));
+    terrainIndices = cacheItems(CACHE_INDICES, sizeof(int), &indexTotal);
+    terrainRunKeys = cacheItems(CACHE_RUN_KEYS, sizeof(int), &runTotal);
+    terrainRunStarts = cacheArray(CACHE_RUN_STARTS, (size_t)runTotal, sizeof(int));
+    detailVerts = cacheArray(CACHE_DETAIL_VERTS, (size_t)tiles * 4, sizeof(Vec3));
+    detailUVs = cacheArray(CACHE_DETAIL_UVS, (size_t)tiles * 4, sizeof(SDL_FPoint));
+    detailIndices = cacheArray(CACHE_DETAIL_INDICES, (size_t)tiles * 6, sizeof(int));
+    wallRuns = cacheArray(CACHE_WALL_RUNS, (size_t)info->faceCount, sizeof(WallRun));
+    wallTileRuns = cacheArray(CACHE_WALL_TILE_RUNS, (size_t)info->wallTileCount, sizeof(WallRun));
+    chunkWallStorage = cacheItems(CACHE_WALL_LISTS, sizeof(int), &wallInts);
+    chunkDetailWalls = cacheArray(CACHE_DETAIL_WALLS, (size_t)info->wallTileCount, sizeof(int));
+    floorRects = cacheArray(CACHE_FLOOR_RECTS, (size_t)info->floorRectCount, sizeof(FloorRect));
+    const Uint8 *grass = cacheArray(CACHE_GRASS, (size_t)info->grassW * (size_t)info->grassH, 4);
+    if (!heightmap || !records || !nodes || !terrainVerts || !terrainUVs || !terrainIndices ||
+        !terrainRunKeys || !terrainRunStarts || !detailVerts || !detailUVs || !detailIndices ||
+        !wallRuns || !wallTileRuns || !chunkWallStorage || !chunkDetailWalls || !floorRects || !grass) {
+        return 0;
+    }
+
+    chunks = calloc((size_t)info->chunkCount, sizeof(TerrainChunk));
+    lodChunks = calloc((size_t)(info->lodChunkCount > 0 ? info->lodChunkCount : 1), sizeof(TerrainChunk));
+    terrainNodes = malloc((size_t)total * sizeof(TerrainNode));
+    if (!chunks || !lodChunks || !terrainNodes) {
+        printf("Failed to allocate %d cached chunks\n", total);
+        return 0;
+    }
+
+    for (int n = 0; n < total; n++) {
+        const CachedChunk *r = &records[n];
+        const CachedNode *cn = &nodes[n];
+        int leaf = n < info->chunkCount;
+        if (r->tilesX < 0 || r->tilesX > CHUNK_TILES || r->tilesZ < 0 || r->tilesZ > CHUNK_TILES ||
+            !inRange(r->firstVert, r->vertCount, 1, vertTotal) ||
+            !inRange(r->firstIndex, r->indexCount, 4, indexTotal) ||
+            !inRange(r->firstRun, r->runCount + 1, 4, runTotal) ||
+            !inRange(r->firstWall, r->wallCount, 8, wallInts) ||
+            (leaf && !inRange(r->firstDetail, r->tilesX * r->tilesZ, 1, tiles)) ||
+            (leaf && !inRange(r->firstDetailWall, r->detailWallCount, 1, info->wallTileCount)) ||
+            cn->parent < -1 || cn->parent >= total) {
+            printf("Level cache chunk %d is out of range\n", n);
+            return 0;
+        }
+        for (int k = 0; k < 4; k++) {
+            if (cn->children[k] < -1 || cn->children[k] >= total) {
+                printf("Level cache chunk %d is out of range\n", n);
+                return 0;
+            }
+        }
+
+        TerrainChunk *c = leaf ? &chunks[n] : &lodChunks[n - info->chunkCount];
+        c->level = r->level;
+        c->tileX = r->tileX;
+        c->tileZ = r->tileZ;
+        c->tilesX = r->tilesX;
+        c->tilesZ = r->tilesZ;
+        c->runCount = r->runCount;
+        c->wallCount = r->wallCount;
+        for (int o = 0; o < 4; o++) {
+            c->orders[o] = &terrainIndices[r->firstIndex + o * r->indexCount];
+            c->runKeys[o] = &terrainRunKeys[r->firstRun + o * (r->runCount + 1)];
+            c->runStarts[o] = &terrainRunStarts[r->firstRun + o * (r->runCount + 1)];
+            c->walls[o] = &chunkWallStorage[r->firstWall + o * r->wallCount];
+            c->wallSlots[o] = &chunkWallStorage[r->firstWall + (4 + o) * r->wallCount];
+        }
+        Mesh mesh = {
+            &terrainVerts[r->firstVert], &terrainUVs[r->firstVert], r->vertCount,
+            c->orders[0], r->indexCount,
+            NULL, RENDER3D_CULL_BACK,
+        };
+        render3dInitMeshInstance(&c->inst, mesh, (SDL_Color){255, 255, 255, 255});
+        if (leaf) {
+            int d = r->firstDetail, count = r->tilesX * r->tilesZ;
+            c->detail = (Mesh){
+                &detailVerts[d * 4], &detailUVs[d * 4], count * 4,
+                &detailIndices[d * 6], count * 6,
+                NULL, RENDER3D_CULL_BACK,
+            };
+            c->detailWallCount = r->detailWallCount;
+            c->detailWalls = &chunkDetailWalls[r->firstDetailWall];
+        }
+        terrainNodes[n] = (TerrainNode){
+            cn->level, c, cn->parent,
+            {cn->children[0], cn->children[1], cn->children[2], cn->children[3]},
+            cn->error, cn->min, cn->max,
+        };
+    }
+    chunkCount = info->chunkCount;
+    lodChunkCount = info->lodChunkCount;
+    terrainNodeCount = total;
+    if (!cachedChunksValid(info->faceCount, info->wallTileCount)) {
+        printf("Level cache chunks do not check out\n");
+        return 0;
+    }
+    terrainRoot = total - 1;
+
+    // the grass first: the chunks and floor take its texture
+    if (!gGrassTexture) {
+        SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, info->grassW, info->grassH, 32, SDL_PIXELFORMAT_RGBA32);
+        if (surface) {
+            for (int y = 0; y < info->grassH; y++) {
+                memcpy((Uint8 *)surface->pixels + y * surface->pitch, grass + (size_t)y * info->grassW * 4,
+                       (size_t)info->grassW * 4);
+            }
+            gGrassTexture = uploadGrass(surface);
+        }
+    }
+    finishTerrainChunks();
+
+    faceCount = info->faceCount;
+    wallTileCount = info->wallTileCount;
+    faces = malloc((size_t)(faceCount > 0 ? faceCount : 1) * sizeof(MeshInstance));
+    wallTiles = malloc((size_t)(wallTileCount > 0 ? wallTileCount : 1) * sizeof(MeshInstance));
+    if (!faces || !wallTiles) {
+        printf("Failed to allocate %d walls\n", faceCount + wallTileCount);
+        faceCount = wallTileCount = 0;
+        return 0;
+    }
+    for (int i = 0; i < faceCount; i++) buildWallQuad(&faces[i], &wallRuns[i]);
+    for (int i = 0; i < wallTileCount; i++) buildWallQuad(&wallTiles[i], &wallTileRuns[i]);
+    fitChunkBounds();
+
+    floorRectCount = info->floorRectCount;
+    buildFloorQuads();
+    if (!floorFaces) return 0;
+
+    printf("level: %dx%d from the cache: %d chunks, %d LOD chunks, %d + %d faces, %d floor quads\n",
+           width, height, chunkCount, lodChunkCount, terrainRunCount, faceCount, floorCount);
+    return 1;
 }
 
 // -------------------------------------------------------------
 // Level init entry point (called from wolf3dInit)
 // -------------------------------------------------------------
 
-void levelInit(void) {
+// Drops every buffer of the current level.
+static void freeLevel(void) {
+    // arrays in the cache file go with it
+    if (gCache) {
+        heightmap = NULL;
+        terrainVerts = detailVerts = NULL;
+        terrainUVs = detailUVs = NULL;
+        terrainIndices = detailIndices = NULL;
+        terrainRunKeys = terrainRunStarts = NULL;
+        wallRuns = wallTileRuns = NULL;
+        chunkWallStorage = chunkDetailWalls = NULL;
+        floorRects = NULL;
+        levelCacheClose(gCache);
+        gCache = NULL;
+    }
+    freeTerrainLod();
+    free(chunkWallStorage);
+    free(heightmap);
+    free(faces);
+    free(wallTiles);
+    free(wallRuns);
+    free(wallTileRuns);
+    free(chunkDetailWalls);
+    free(chunks);
+    free(terrainVerts);
+    free(terrainUVs);
+    free(terrainIndices);
+    free(detailVerts);
+    free(detailUVs);
+    free(detailIndices);
+    free(terrainRunKeys);
+    free(terrainRunStarts);
+    free(floorFaces);
+    free(floorRects);
+    chunkWallStorage = NULL;
+    heightmap = NULL;
+    faces = wallTiles = floorFaces = NULL;
+    wallRuns = wallTileRuns = NULL;
+    chunkDetailWalls = NULL;
+    chunks = NULL;
+    terrainVerts = detailVerts = NULL;
+    terrainUVs = detailUVs = NULL;
+    terrainIndices = detailIndices = NULL;
+    terrainRunKeys = terrainRunStarts = NULL;
+    faceCount = wallTileCount = wallCapacity = 0;
+    floorRects = NULL;
+    chunkCount = floorCount = floorRectCount = 0;
+    levelInfo = (LevelInfo){0};
+}
+
+void levelInit(int width, int height) {
+    freeLevel();
+    if (width < 2) width = 2;
+    if (height < 2) height = 2;
+
     gNoise = fnlCreateState();
     gNoise.noise_type = FNL_NOISE_PERLIN;
     gNoise.frequency = 0.5f;     // tweak to taste
     gNoise.seed = 1337;
+    gIncomplete = 0;
+
+    // The same level built before comes straight from the cache file.
+    Uint64 key = cacheKey(width, height);
+    LevelCache *cache = levelCacheOpen(key, CACHE_SECTIONS);
+    if (cache) {
+        if (loadLevelCache(cache, width, height)) return;
+        printf("Failed to load the level cache, building\n");
+        freeLevel();
+    }
 
-    gGrassTexture = createGrassTexture();
+    int built = 0;
+    heightmap = malloc((size_t)width * (size_t)height * sizeof(int));
+    if (!heightmap) {
+        printf("Failed to allocate a %dx%d level\n", width, height);
+    } else {
+        setLevelSize(width, height);
+        built = allocTerrainChunks();
+        if (built) allocTerrainLod();
+    }
+    if (!built) freeLevel();
+
+    // Heights, chunk rows, floor cells and the grass on every core; only
+    // the upload and what needs the whole level stay on this thread.
+    float *noise = built ? malloc((size_t)width * (size_t)height * sizeof(float)) : NULL;
+    unsigned char *open = built ? malloc((size_t)width * (size_t)height) : NULL;
+    SDL_Surface *grass = NULL;
+    if (!runBuild(built ? levelInfo.chunksZ : 0, noise, open, &grass) && built) {
+        free(open);
+        freeLevel();
+        built = 0;
+    }
+    free(noise);
+    if (grass) gGrassTexture = uploadGrass(grass);
+    if (!built) return;
 
-    generateLevel();
     buildLevelGeometry();
-    buildFloorGeometry();
+    buildFloorGeometry(open);
+    saveLevelCache(key);
 }
-
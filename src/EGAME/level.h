@@ -0,0 +1,63 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "wolf3d.h"
+
+// -------------------------------------------------------------
+// Shared map config
+// -------------------------------------------------------------
+
+static const float TILE_SIZE   = 1.0f;
+static const float WALL_HEIGHT = 0.1f;
+
+// Big height jump treated as a wall
+static const int WALL_DIFF_THRESHOLD = 4;
+
+// Size of the loaded level: width x height height samples, so one tile
+// less each way, in chunksX x chunksZ terrain chunks.
+typedef struct {
+    int width, height;
+    int tilesX, tilesZ;
+    int chunksX, chunksZ;
+} LevelInfo;
+
+extern LevelInfo levelInfo;
+
+// -------------------------------------------------------------
+// Geometry built by levelInit, on the heap and sized to the level
+// -------------------------------------------------------------
+
+// Walls, one instance per merged run
+extern MeshInstance *faces;
+extern int faceCount;
+// The same walls one tile edge each, for the chunk drawn per triangle
+extern MeshInstance *wallTiles;
+extern int wallTileCount;
+
+extern TerrainChunk *chunks;
+extern int chunkCount;
+extern TerrainNode *terrainNodes;
+extern int terrainNodeCount;
+extern int terrainRoot;
+
+extern MeshInstance *floorFaces;
+extern int floorCount;
+
+// Generates and builds a width x height level (at least 2 x 2), freeing
+// the previous one, on as many threads as there are cores; only the grass
+// texture upload needs the calling (render) thread. The finished level is
+// written to the level cache (levelcache.h), and later calls with the same
+// size, noise and generator version map it back instead of building.
+// Leaves an empty level when out of memory.
+void levelInit(int width, int height);
+
+// Heights in steps at tile corners and interpolated in world units; from
+// the streamed world (world.h) while streaming is on, else from the level.
+int   tileHeight(int x, int z);
+float sampleHeightAt(float wx, float wz);
+void  levelSetStreaming(int on);
+int   levelStreaming(void);
+// The grass texture every terrain chunk repeats.
+SDL_Texture *levelGrassTexture(void);
+
+#endif
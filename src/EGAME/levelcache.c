@@ -0,0 +1,264 @@
+#include "levelcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(__EMSCRIPTEN__) && (defined(__unix__) || defined(__APPLE__))
+#define LEVELCACHE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define LEVELCACHE_FILE "level.cache"
+// Bump when the header changes; what goes in the sections is up to the
+// key.
+#define LEVELCACHE_FORMAT 1
+#define LEVELCACHE_ENDIAN 0x01020304u
+
+static const char LEVELCACHE_MAGIC[8] = {'L', 'V', 'L', 'C', 'A', 'C', 'H', 'E'};
+
+typedef struct {
+    char magic[8];
+    Uint32 format;
+    Uint32 endian;         // LEVELCACHE_ENDIAN as written
+    Uint64 key;
+    Uint64 fileSize;
+    Uint32 sectionCount;
+    Uint32 pad;
+    Uint64 offsets[LEVELCACHE_MAX_SECTIONS];
+    Uint64 sizes[LEVELCACHE_MAX_SECTIONS];
+} LevelCacheHeader;
+
+struct LevelCache {
+    Uint8 *base;
+    size_t size;
+    int mapped;            // else read into the heap
+    const LevelCacheHeader *header;
+};
+
+struct LevelCacheWriter {
+    FILE *file;
+    char *path;
+    char *tempPath;
+    LevelCacheHeader header;
+    Uint64 written;
+    int failed;
+};
+
+Uint64 levelCacheHash(Uint64 hash, const void *data, size_t size) {
+    const Uint8 *p = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// The cache file, plus suffix; NULL without a pref directory.
+static char *cachePath(const char *suffix) {
+#ifdef __EMSCRIPTEN__
+    (void)suffix;
+    return NULL;
+#else
+    char *pref = SDL_GetPrefPath("madlumi", "island");
+    if (!pref) return NULL;
+    size_t len = strlen(pref) + strlen(LEVELCACHE_FILE) + strlen(suffix) + 1;
+    char *path = malloc(len);
+    if (path) snprintf(path, len, "%s%s%s", pref, LEVELCACHE_FILE, suffix);
+    SDL_free(pref);
+    return path;
+#endif
+}
+
+// -------------------------------------------------------------
+// Reading
+// -------------------------------------------------------------
+
+static int validHeader(const LevelCache *cache, Uint64 key, int count) {
+    if (cache->size < sizeof(LevelCacheHeader)) return 0;
+    const LevelCacheHeader *h = cache->header;
+    if (memcmp(h->magic, LEVELCACHE_MAGIC, sizeof h->magic) != 0) return 0;
+    if (h->format != LEVELCACHE_FORMAT || h->endian != LEVELCACHE_ENDIAN) return 0;
+    if (h->key != key || h->fileSize != cache->size || h->sectionCount != (Uint32)count) return 0;
+    for (int i = 0; i < count; i++) {
+        if (h->offsets[i] % LEVELCACHE_ALIGN != 0 || h->offsets[i] > cache->size ||
+            h->sizes[i] > cache->size - h->offsets[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Whole file into the heap, where there is no mmap or it failed.
+static int readWhole(LevelCache *cache, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size <= 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return 0;
+    }
+    cache->base = malloc((size_t)size);
+    cache->size = (size_t)size;
+    int ok = cache->base && fread(cache->base, 1, cache->size, f) == cache->size;
+    fclose(f);
+    if (!ok) {
+        free(cache->base);
+        cache->base = NULL;
+    }
+    return ok;
+}
+
+LevelCache *levelCacheOpen(Uint64 key, int count) {
+    if (count < 0 || count > LEVELCACHE_MAX_SECTIONS) return NULL;
+    char *path = cachePath("");
+    if (!path) return NULL;
+    LevelCache *cache = calloc(1, sizeof(LevelCache));
+    if (!cache) {
+        free(path);
+        return NULL;
+    }
+
+#ifdef LEVELCACHE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            // Private and writable: the level owns its buffers as if they
+            // were its own allocations, and copy-on-write keeps the file
+            // as it was.
+            void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (base != MAP_FAILED) {
+                cache->base = base;
+                cache->size = (size_t)st.st_size;
+                cache->mapped = 1;
+            }
+        }
+        close(fd);
+    }
+#endif
+    if (!cache->base) readWhole(cache, path);
+    free(path);
+
+    if (!cache->base) {
+        free(cache);
+        return NULL;
+    }
+    cache->header = (const LevelCacheHeader *)cache->base;
+    if (!validHeader(cache, key, count)) {
+        levelCacheClose(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void *levelCacheSection(const LevelCache *cache, int i, size_t *size) {
+    if (!cache || i < 0 || (Uint32)i >= cache->header->sectionCount) {
+        if (size) *size = 0;
+        return NULL;
+    }
+    if (size) *size = (size_t)cache->header->sizes[i];
+    return cache->base + cache->header->offsets[i];
+}
+
+void levelCacheClose(LevelCache *cache) {
+    if (!cache) return;
+#ifdef LEVELCACHE_MMAP
+    if (cache->mapped) munmap(cache->base, cache->size);
+    else free(cache->base);
+#else
+    free(cache->base);
+#endif
+    free(cache);
+}
+
+// -------------------------------------------------------------
+// Writing
+// -------------------------------------------------------------
+
+static void writeBytes(LevelCacheWriter *w, const void *data, size_t size) {
+    if (w->failed || size == 0) return;
+    if (fwrite(data, 1, size, w->file) != size) w->failed = 1;
+    w->written += size;
+}
+
+static void writePadding(LevelCacheWriter *w) {
+    static const Uint8 zeros[LEVELCACHE_ALIGN];
+    size_t pad = (size_t)((LEVELCACHE_ALIGN - w->written % LEVELCACHE_ALIGN) % LEVELCACHE_ALIGN);
+    writeBytes(w, zeros, pad);
+}
+
+// Closes the section in progress, if any.
+static void endSection(LevelCacheWriter *w) {
+    Uint32 n = w->header.sectionCount;
+    if (n > 0) w->header.sizes[n - 1] = w->written - w->header.offsets[n - 1];
+}
+
+LevelCacheWriter *levelCacheCreate(Uint64 key) {
+    LevelCacheWriter *w = calloc(1, sizeof(LevelCacheWriter));
+    if (!w) return NULL;
+    w->path = cachePath("");
+    w->tempPath = cachePath(".tmp");
+    w->file = w->tempPath ? fopen(w->tempPath, "wb") : NULL;
+    if (!w->path || !w->file) {
+        if (w->file) fclose(w->file);
+        free(w->path);
+        free(w->tempPath);
+        free(w);
+        return NULL;
+    }
+    memcpy(w->header.magic, LEVELCACHE_MAGIC, sizeof w->header.magic);
+    w->header.format = LEVELCACHE_FORMAT;
+    w->header.endian = LEVELCACHE_ENDIAN;
+    w->header.key = key;
+    // the real header goes in once the sections are known
+    writeBytes(w, &w->header, sizeof w->header);
+    return w;
+}
+
+void levelCacheBeginSection(LevelCacheWriter *w) {
+    if (!w) return;
+    if (w->header.sectionCount == LEVELCACHE_MAX_SECTIONS) {
+        w->failed = 1;
+        return;
+    }
+    endSection(w);
+    writePadding(w);
+    w->header.offsets[w->header.sectionCount++] = w->written;
+}
+
+void levelCacheAppend(LevelCacheWriter *w, const void *data, size_t size) {
+    if (!w) return;
+    if (w->header.sectionCount == 0) w->failed = 1;
+    writeBytes(w, data, size);
+}
+
+int levelCacheFinish(LevelCacheWriter *w) {
+    if (!w) return 0;
+    endSection(w);
+    writePadding(w);
+    w->header.fileSize = w->written;
+    if (!w->failed && (fseek(w->file, 0, SEEK_SET) != 0 ||
+                       fwrite(&w->header, sizeof w->header, 1, w->file) != 1)) {
+        w->failed = 1;
+    }
+    if (fclose(w->file) != 0) w->failed = 1;
+
+    int ok = !w->failed;
+    if (ok) {
+#ifdef _WIN32
+        // rename does not replace an existing file here
+        remove(w->path);
+#endif
+        ok = rename(w->tempPath, w->path) == 0;
+    }
+    if (!ok) remove(w->tempPath);
+    free(w->path);
+    free(w->tempPath);
+    free(w);
+    return ok;
+}
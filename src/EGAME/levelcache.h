@@ -0,0 +1,40 @@
+#ifndef LEVELCACHE_H
+#define LEVELCACHE_H
+
+#include <SDL.h>
+#include <stddef.h>
+
+// Binary cache of the last built level, one file in the user's pref
+// directory: a header with the cache key and a section table, then the
+// sections, each starting on a LEVELCACHE_ALIGN boundary so their arrays
+// can be used in place. The file is memory-mapped where the platform
+// allows and read whole elsewhere; without a persistent file system
+// (wasm) there is no cache. A different key, format or size is a miss.
+#define LEVELCACHE_ALIGN 64
+#define LEVELCACHE_MAX_SECTIONS 32
+
+typedef struct LevelCache LevelCache;
+typedef struct LevelCacheWriter LevelCacheWriter;
+
+// FNV-1a over size bytes, continuing from hash; start from
+// LEVELCACHE_HASH_SEED.
+#define LEVELCACHE_HASH_SEED 0xcbf29ce484222325ull
+Uint64 levelCacheHash(Uint64 hash, const void *data, size_t size);
+
+// The cached level for key with count sections, or NULL.
+LevelCache *levelCacheOpen(Uint64 key, int count);
+// Section i and its size in bytes; valid until levelCacheClose. The
+// mapping is private, so writing to it never reaches the file.
+void *levelCacheSection(const LevelCache *cache, int i, size_t *size);
+void levelCacheClose(LevelCache *cache);
+
+// Replaces the cache with a new file for key: sections in order, each
+// from any number of appends. It is written under a temporary name and
+// renamed over the old file by levelCacheFinish, which returns 0 when
+// anything failed and leaves the old file alone.
+LevelCacheWriter *levelCacheCreate(Uint64 key);
+void levelCacheBeginSection(LevelCacheWriter *w);
+void levelCacheAppend(LevelCacheWriter *w, const void *data, size_t size);
+int levelCacheFinish(LevelCacheWriter *w);
+
+#endif
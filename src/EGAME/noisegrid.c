@@ -0,0 +1,342 @@
+// The FastNoiseLite implementation lives here so the kernels below can use
+// its gradient table and helpers.
+#define FNL_IMPL
+#include "noisegrid.h"
+#include <SDL.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NOISEGRID_SSE2 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define NOISEGRID_WASM 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define NOISEGRID_NEON 1
+#endif
+
+static void scalarRows(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int j0, int j1,
+                       float *out) {
+    for (int j = j0; j < j1; j++) {
+        float y = y0 + (float)j * dy;
+        for (int i = 0; i < w; i++) out[j * w + i] = fnlGetNoise2D(state, x0 + (float)i * dx, y);
+    }
+}
+
+#if defined(NOISEGRID_SSE2) || defined(NOISEGRID_WASM) || defined(NOISEGRID_NEON)
+
+// Masks are I4 lanes of all ones or zeros.
+#if defined(NOISEGRID_SSE2)
+typedef __m128 F4;
+typedef __m128i I4;
+static inline F4 f4Load(const float *p) { return _mm_loadu_ps(p); }
+static inline void f4Store(float *p, F4 v) { _mm_storeu_ps(p, v); }
+static inline F4 f4Set(float s) { return _mm_set1_ps(s); }
+static inline F4 f4Add(F4 a, F4 b) { return _mm_add_ps(a, b); }
+static inline F4 f4Sub(F4 a, F4 b) { return _mm_sub_ps(a, b); }
+static inline F4 f4Mul(F4 a, F4 b) { return _mm_mul_ps(a, b); }
+static inline I4 f4Lt(F4 a, F4 b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+static inline F4 f4Select(I4 m, F4 a, F4 b) {
+    return _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(m), a), _mm_andnot_ps(_mm_castsi128_ps(m), b));
+}
+static inline I4 f4Trunc(F4 a) { return _mm_cvttps_epi32(a); }
+static inline F4 i4ToF4(I4 a) { return _mm_cvtepi32_ps(a); }
+static inline void i4Store(int *p, I4 v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline I4 i4Set(int s) { return _mm_set1_epi32(s); }
+static inline I4 i4Add(I4 a, I4 b) { return _mm_add_epi32(a, b); }
+static inline I4 i4Xor(I4 a, I4 b) { return _mm_xor_si128(a, b); }
+static inline I4 i4And(I4 a, I4 b) { return _mm_and_si128(a, b); }
+static inline I4 i4Sra(I4 a, int n) { return _mm_srai_epi32(a, n); }
+static inline I4 i4Select(I4 m, I4 a, I4 b) { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+// SSE2 has no 32-bit low multiply: even and odd lanes through 64-bit products.
+static inline I4 i4Mul(I4 a, I4 b) {
+    I4 even = _mm_mul_epu32(a, b);
+    I4 odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#define NOISEGRID_NAME "sse2"
+#elif defined(NOISEGRID_WASM)
+typedef v128_t F4;
+typedef v128_t I4;
+static inline F4 f4Load(const float *p) { return wasm_v128_load(p); }
+static inline void f4Store(float *p, F4 v) { wasm_v128_store(p, v); }
+static inline F4 f4Set(float s) { return wasm_f32x4_splat(s); }
+static inline F4 f4Add(F4 a, F4 b) { return wasm_f32x4_add(a, b); }
+static inline F4 f4Sub(F4 a, F4 b) { return wasm_f32x4_sub(a, b); }
+static inline F4 f4Mul(F4 a, F4 b) { return wasm_f32x4_mul(a, b); }
+static inline I4 f4Lt(F4 a, F4 b) { return wasm_f32x4_lt(a, b); }
+static inline F4 f4Select(I4 m, F4 a, F4 b) { return wasm_v128_bitselect(a, b, m); }
+static inline I4 f4Trunc(F4 a) { return wasm_i32x4_trunc_sat_f32x4(a); }
+static inline F4 i4ToF4(I4 a) { return wasm_f32x4_convert_i32x4(a); }
+static inline void i4Store(int *p, I4 v) { wasm_v128_store(p, v); }
+static inline I4 i4Set(int s) { return wasm_i32x4_splat(s); }
+static inline I4 i4Add(I4 a, I4 b) { return wasm_i32x4_add(a, b); }
+static inline I4 i4Xor(I4 a, I4 b) { return wasm_v128_xor(a, b); }
+static inline I4 i4And(I4 a, I4 b) { return wasm_v128_and(a, b); }
+static inline I4 i4Sra(I4 a, int n) { return wasm_i32x4_shr(a, n); }
+static inline I4 i4Select(I4 m, I4 a, I4 b) { return wasm_v128_bitselect(a, b, m); }
+static inline I4 i4Mul(I4 a, I4 b) { return wasm_i32x4_mul(a, b); }
+#define NOISEGRID_NAME "simd128"
+#else
+typedef float32x4_t F4;
+typedef int32x4_t I4;
+static inline F4 f4Load(const float *p) { return vld1q_f32(p); }
+static inline void f4Store(float *p, F4 v) { vst1q_f32(p, v); }
+static inline F4 f4Set(float s) { return vdupq_n_f32(s); }
+static inline F4 f4Add(F4 a, F4 b) { return vaddq_f32(a, b); }
+static inline F4 f4Sub(F4 a, F4 b) { return vsubq_f32(a, b); }
+static inline F4 f4Mul(F4 a, F4 b) { return vmulq_f32(a, b); }
+static inline I4 f4Lt(F4 a, F4 b) { return vreinterpretq_s32_u32(vcltq_f32(a, b)); }
+static inline F4 f4Select(I4 m, F4 a, F4 b) { return vbslq_f32(vreinterpretq_u32_s32(m), a, b); }
+static inline I4 f4Trunc(F4 a) { return vcvtq_s32_f32(a); }
+static inline F4 i4ToF4(I4 a) { return vcvtq_f32_s32(a); }
+static inline void i4Store(int *p, I4 v) { vst1q_s32(p, v); }
+static inline I4 i4Set(int s) { return vdupq_n_s32(s); }
+static inline I4 i4Add(I4 a, I4 b) { return vaddq_s32(a, b); }
+static inline I4 i4Xor(I4 a, I4 b) { return veorq_s32(a, b); }
+static inline I4 i4And(I4 a, I4 b) { return vandq_s32(a, b); }
+static inline I4 i4Sra(I4 a, int n) { return vshlq_s32(a, vdupq_n_s32(-n)); }
+static inline I4 i4Select(I4 m, I4 a, I4 b) { return vbslq_s32(vreinterpretq_u32_s32(m), a, b); }
+static inline I4 i4Mul(I4 a, I4 b) { return vmulq_s32(a, b); }
+#define NOISEGRID_NAME "neon"
+#endif
+
+// Each helper below mirrors its _fnl counterpart expression for expression.
+
+// _fnlFastFloor: truncate, one less for negatives (whole ones included).
+static inline I4 fastFloor(F4 f) {
+    return i4Add(f4Trunc(f), f4Lt(f, f4Set(0.0f)));
+}
+
+static inline F4 fastMin(F4 a, F4 b) { return f4Select(f4Lt(a, b), a, b); }
+
+static inline F4 fastAbs(F4 f) { return f4Select(f4Lt(f, f4Set(0.0f)), f4Sub(f4Set(0.0f), f), f); }
+
+static inline F4 lerp(F4 a, F4 b, F4 t) { return f4Add(a, f4Mul(t, f4Sub(b, a))); }
+
+static inline F4 interpQuintic(F4 t) {
+    F4 inner = f4Add(f4Mul(t, f4Sub(f4Mul(t, f4Set(6.0f)), f4Set(15.0f))), f4Set(10.0f));
+    return f4Mul(f4Mul(f4Mul(t, t), t), inner);
+}
+
+// The table lookup has no SSE2 gather, so it goes through memory.
+static inline F4 gradCoord(I4 seed, I4 xPrimed, I4 yPrimed, F4 xd, F4 yd) {
+    I4 hash = i4Mul(i4Xor(i4Xor(seed, xPrimed), yPrimed), i4Set(0x27d4eb2d));
+    hash = i4And(i4Xor(hash, i4Sra(hash, 15)), i4Set(127 << 1));
+    int idx[4];
+    float gx[4], gy[4];
+    i4Store(idx, hash);
+    for (int k = 0; k < 4; k++) {
+        gx[k] = GRADIENTS_2D[idx[k]];
+        gy[k] = GRADIENTS_2D[idx[k] | 1];
+    }
+    return f4Add(f4Mul(xd, f4Load(gx)), f4Mul(yd, f4Load(gy)));
+}
+
+static F4 perlin4(I4 seed, F4 x, F4 y) {
+    I4 x0 = fastFloor(x);
+    I4 y0 = fastFloor(y);
+    F4 xd0 = f4Sub(x, i4ToF4(x0));
+    F4 yd0 = f4Sub(y, i4ToF4(y0));
+    F4 xd1 = f4Sub(xd0, f4Set(1.0f));
+    F4 yd1 = f4Sub(yd0, f4Set(1.0f));
+    F4 xs = interpQuintic(xd0);
+    F4 ys = interpQuintic(yd0);
+
+    x0 = i4Mul(x0, i4Set(PRIME_X));
+    y0 = i4Mul(y0, i4Set(PRIME_Y));
+    I4 x1 = i4Add(x0, i4Set(PRIME_X));
+    I4 y1 = i4Add(y0, i4Set(PRIME_Y));
+
+    F4 xf0 = lerp(gradCoord(seed, x0, y0, xd0, yd0), gradCoord(seed, x1, y0, xd1, yd0), xs);
+    F4 xf1 = lerp(gradCoord(seed, x0, y1, xd0, yd1), gradCoord(seed, x1, y1, xd1, yd1), xs);
+    return f4Mul(lerp(xf0, xf1, ys), f4Set(1.4247691104677813f));
+}
+
+// _fnlSingleSimplex2D with its branches as selects; a contribution whose
+// falloff is not positive is exactly zero either way.
+static F4 simplex4(I4 seed, F4 x, F4 y) {
+    const float SQRT3 = 1.7320508075688772935274463415059f;
+    const float G2 = (3 - SQRT3) / 6;
+    const F4 zero = f4Set(0.0f);
+    const F4 half = f4Set(0.5f);
+
+    I4 i = fastFloor(x);
+    I4 j = fastFloor(y);
+    F4 xi = f4Sub(x, i4ToF4(i));
+    F4 yi = f4Sub(y, i4ToF4(j));
+
+    F4 t = f4Mul(f4Add(xi, yi), f4Set(G2));
+    F4 x0 = f4Sub(xi, t);
+    F4 y0 = f4Sub(yi, t);
+
+    i = i4Mul(i, i4Set(PRIME_X));
+    j = i4Mul(j, i4Set(PRIME_Y));
+
+    F4 a = f4Sub(f4Sub(half, f4Mul(x0, x0)), f4Mul(y0, y0));
+    F4 a4 = f4Mul(f4Mul(a, a), f4Mul(a, a));
+    F4 n0 = f4Select(f4Lt(zero, a), f4Mul(a4, gradCoord(seed, i, j, x0, y0)), zero);
+
+    F4 c = f4Add(f4Mul(f4Set((float)(2 * (1 - 2 * G2) * (1 / G2 - 2))), t),
+                 f4Add(f4Set((float)(-2 * (1 - 2 * G2) * (1 - 2 * G2))), a));
+    F4 x2 = f4Add(x0, f4Set(2 * (float)G2 - 1));
+    F4 y2 = f4Add(y0, f4Set(2 * (float)G2 - 1));
+    F4 c4 = f4Mul(f4Mul(c, c), f4Mul(c, c));
+    I4 i2 = i4Add(i, i4Set(PRIME_X));
+    I4 j2 = i4Add(j, i4Set(PRIME_Y));
+    F4 n2 = f4Select(f4Lt(zero, c), f4Mul(c4, gradCoord(seed, i2, j2, x2, y2)), zero);
+
+    // y0 > x0 picks the upper triangle's middle corner
+    I4 upper = f4Lt(x0, y0);
+    F4 x1 = f4Select(upper, f4Add(x0, f4Set((float)G2)), f4Add(x0, f4Set((float)G2 - 1)));
+    F4 y1 = f4Select(upper, f4Add(y0, f4Set((float)G2 - 1)), f4Add(y0, f4Set((float)G2)));
+    F4 b = f4Sub(f4Sub(half, f4Mul(x1, x1)), f4Mul(y1, y1));
+    F4 b4 = f4Mul(f4Mul(b, b), f4Mul(b, b));
+    I4 i1 = i4Select(upper, i, i2);
+    I4 j1 = i4Select(upper, j2, j);
+    F4 n1 = f4Select(f4Lt(zero, b), f4Mul(b4, gradCoord(seed, i1, j1, x1, y1)), zero);
+
+    return f4Mul(f4Add(f4Add(n0, n1), n2), f4Set(99.83685446303647f));
+}
+
+static inline F4 single4(int simplex, I4 seed, F4 x, F4 y) {
+    return simplex ? simplex4(seed, x, y) : perlin4(seed, x, y);
+}
+
+// fnlGetNoise2D for four points: frequency and skew, then the fractal.
+static F4 noise4(const fnl_state *state, int simplex, F4 x, F4 y) {
+    x = f4Mul(x, f4Set(state->frequency));
+    y = f4Mul(y, f4Set(state->frequency));
+    if (simplex) {
+        const FNLfloat SQRT3 = (FNLfloat)1.7320508075688772935274463415059;
+        const FNLfloat F2 = 0.5f * (SQRT3 - 1);
+        F4 t = f4Mul(f4Add(x, y), f4Set(F2));
+        x = f4Add(x, t);
+        y = f4Add(y, t);
+    }
+
+    int fbm = state->fractal_type == FNL_FRACTAL_FBM;
+    if (!fbm && state->fractal_type != FNL_FRACTAL_RIDGED) return single4(simplex, i4Set(state->seed), x, y);
+
+    const F4 one = f4Set(1.0f);
+    const F4 weighted = f4Set(state->weighted_strength);
+    int seed = state->seed;
+    F4 sum = f4Set(0.0f);
+    F4 amp = f4Set(_fnlCalculateFractalBounding(state));
+    for (int o = 0; o < state->octaves; o++) {
+        F4 noise = single4(simplex, i4Set(seed++), x, y);
+        if (fbm) {
+            sum = f4Add(sum, f4Mul(noise, amp));
+            amp = f4Mul(amp, lerp(one, f4Mul(fastMin(f4Add(noise, one), f4Set(2.0f)), f4Set(0.5f)), weighted));
+        } else {
+            noise = fastAbs(noise);
+            sum = f4Add(sum, f4Mul(f4Add(f4Mul(noise, f4Set(-2.0f)), one), amp));
+            amp = f4Mul(amp, lerp(one, f4Sub(one, noise), weighted));
+        }
+        x = f4Mul(x, f4Set(state->lacunarity));
+        y = f4Mul(y, f4Set(state->lacunarity));
+        amp = f4Mul(amp, f4Set(state->gain));
+    }
+    return sum;
+}
+
+static int hasKernel(const fnl_state *state) {
+    if (state->noise_type != FNL_NOISE_PERLIN && state->noise_type != FNL_NOISE_OPENSIMPLEX2) return 0;
+    // ping-pong's (int) wrap stays scalar
+    return state->fractal_type != FNL_FRACTAL_PINGPONG;
+}
+
+static void fillRows(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int j0, int j1,
+                     float *out) {
+    if (!hasKernel(state)) {
+        scalarRows(state, x0, y0, dx, dy, w, j0, j1, out);
+        return;
+    }
+    int simplex = state->noise_type == FNL_NOISE_OPENSIMPLEX2;
+    for (int j = j0; j < j1; j++) {
+        float y = y0 + (float)j * dy;
+        F4 vy = f4Set(y);
+        int i = 0;
+        for (; i + 4 <= w; i += 4) {
+            float xs[4];
+            for (int k = 0; k < 4; k++) xs[k] = x0 + (float)(i + k) * dx;
+            f4Store(out + j * w + i, noise4(state, simplex, f4Load(xs), vy));
+        }
+        for (; i < w; i++) out[j * w + i] = fnlGetNoise2D(state, x0 + (float)i * dx, y);
+    }
+}
+
+const char *fnlGridBackend(void) { return NOISEGRID_NAME; }
+
+#else
+
+static void fillRows(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int j0, int j1,
+                     float *out) {
+    scalarRows(state, x0, y0, dx, dy, w, j0, j1, out);
+}
+
+const char *fnlGridBackend(void) { return "scalar"; }
+
+#endif
+
+// -------------------------------------------------------------
+// Rows across threads
+// -------------------------------------------------------------
+
+typedef struct {
+    const fnl_state *state;
+    float x0, y0, dx, dy;
+    int w, j0, j1;
+    float *out;
+} GridBand;
+
+static int bandMain(void *data) {
+    GridBand *band = data;
+    fillRows(band->state, band->x0, band->y0, band->dx, band->dy, band->w, band->j0, band->j1, band->out);
+    return 0;
+}
+
+static int wantedThreads(void) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 1;
+#else
+    int count = SDL_GetCPUCount();
+    if (count < 1) count = 1;
+    if (count > NOISEGRID_MAX_THREADS) count = NOISEGRID_MAX_THREADS;
+    return count;
+#endif
+}
+
+void fnlFillNoise2DGrid(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int h, float *out) {
+    if (!state || !out || w <= 0 || h <= 0) return;
+
+    int bands = (long)w * h >= NOISEGRID_THREAD_SAMPLES ? wantedThreads() : 1;
+    if (bands > h) bands = h;
+
+    // Band 0 runs here; a band whose thread fails to start does too.
+    GridBand band[NOISEGRID_MAX_THREADS];
+    SDL_Thread *threads[NOISEGRID_MAX_THREADS] = {0};
+    for (int b = 0; b < bands; b++) {
+        band[b] = (GridBand){state, x0, y0, dx, dy, w, h * b / bands, h * (b + 1) / bands, out};
+        if (b > 0) threads[b] = SDL_CreateThread(bandMain, "noisegrid", &band[b]);
+    }
+    for (int b = 0; b < bands; b++) {
+        if (!threads[b]) bandMain(&band[b]);
+    }
+    for (int b = 1; b < bands; b++) {
+        if (threads[b]) SDL_WaitThread(threads[b], NULL);
+    }
+}
+
+void fnlFillNoise2DRows(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int j0, int j1,
+                        float *out) {
+    if (!state || !out || w <= 0 || j0 >= j1) return;
+    fillRows(state, x0, y0, dx, dy, w, j0, j1, out);
+}
+
+void fnlFillNoise2DGridScalar(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int h,
+                              float *out) {
+    if (!state || !out || w <= 0 || h <= 0) return;
+    scalarRows(state, x0, y0, dx, dy, w, 0, h, out);
+}
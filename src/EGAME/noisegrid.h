@@ -0,0 +1,24 @@
+#ifndef NOISEGRID_H
+#define NOISEGRID_H
+
+#include "../lib/FastNoiseLite.h"
+
+// Grids of 2D noise at once, on top of FastNoiseLite: out[j * w + i] gets
+// fnlGetNoise2D(state, x0 + i * dx, y0 + j * dy), with the coordinates
+// worked out in float. Perlin and OpenSimplex2 (single, FBm or ridged) go
+// through SIMD kernels that follow the library's operation order lane for
+// lane, so the grid holds the same bits as the scalar calls; other noise
+// types take the scalar path. Large grids are split by rows across threads.
+#define NOISEGRID_MAX_THREADS 8
+// Smallest grid, in samples, worth handing rows to other threads.
+#define NOISEGRID_THREAD_SAMPLES 16384
+
+void fnlFillNoise2DGrid(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int h, float *out);
+// Rows j0 to j1 - 1 of the same grid, on the calling thread, for callers
+// that share the rows out themselves.
+void fnlFillNoise2DRows(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int j0, int j1,
+                        float *out);
+void fnlFillNoise2DGridScalar(const fnl_state *state, float x0, float y0, float dx, float dy, int w, int h, float *out);
+const char *fnlGridBackend(void);
+
+#endif
@@ -0,0 +1,439 @@
+#include "raster3d.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Attribute planes interpolated across a triangle. Everything but W is
+// premultiplied by W = 1 / view depth, which is linear in screen space, so
+// dividing by W per pixel gives perspective-correct values.
+enum { ATTR_W, ATTR_U, ATTR_V, ATTR_R, ATTR_G, ATTR_B, ATTR_A, ATTR_COUNT };
+
+// value(x, y) = dx * x + dy * y + c, at pixel coordinates.
+typedef struct { float dx, dy, c; } RasterPlane;
+
+// Edge functions are evaluated exactly on a 1/16 pixel grid, so two
+// triangles sharing an edge agree on every pixel centre: with the ownership
+// rule below, shared edges are neither drawn twice nor left as cracks.
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL (1 << SUBPIXEL_BITS)
+// Screen coordinates are clamped here before snapping so products fit.
+static const float COORD_LIMIT = (float)(1 << 20);
+
+typedef struct {
+    // Edge i is opposite vertex i; a*X + b*Y + c >= 0 inside, for X/Y in
+    // subpixel units. Pixels exactly on an edge belong to the one triangle
+    // that owns it; c is biased by -1 on the others.
+    Sint64 a[3], b[3], c[3];
+    RasterPlane attr[ATTR_COUNT];
+    int minX, minY, maxX, maxY;
+    int texture;  // index into gTextures, -1 for vertex color only
+} RasterTri;
+
+typedef struct {
+    int *tris;
+    int count;
+    int capacity;
+} RasterBin;
+
+typedef struct {
+    SDL_Texture *key;
+    Uint8 *pixels;  // RGBA32, tightly packed
+    int w, h;
+} RasterTexture;
+
+static RasterTexture *gTextures = NULL;
+static int gTextureCount = 0;
+static int gTextureCapacity = 0;
+static int gLastTexture = -1;
+
+// Frame state. Buffers and bins keep their capacity across frames.
+static int gWidth = 0, gHeight = 0;
+static int gTilesX = 0, gTilesY = 0;
+static Uint32 *gColor = NULL;
+static float *gDepth = NULL;
+static RasterBin *gBins = NULL;
+static int gBinCount = 0;
+static RasterTri *gTris = NULL;
+static int gTriCount = 0;
+static int gTriCapacity = 0;
+static SDL_Texture *gTarget = NULL;
+static int gTargetW = 0, gTargetH = 0;
+
+// Worker pool: gWorkerCount helper threads plus the calling thread pull
+// tiles off gNextTile until none are left.
+static SDL_Thread *gWorkers[RASTER3D_MAX_THREADS];
+static int gWorkerCount = 0;
+static int gWorkersStarted = 0;
+static int gThreadRequest = 0;
+static SDL_sem *gStartSem = NULL;
+static SDL_sem *gDoneSem = NULL;
+static SDL_atomic_t gNextTile;
+static volatile int gQuit = 0;
+
+static int findTexture(SDL_Texture *texture) {
+    if (!texture) return -1;
+    if (gLastTexture >= 0 && gTextures[gLastTexture].key == texture) return gLastTexture;
+    for (int i = 0; i < gTextureCount; i++) {
+        if (gTextures[i].key == texture) return gLastTexture = i;
+    }
+    return -1;
+}
+
+void raster3dSetTexturePixels(SDL_Texture *texture, const void *pixels, int w, int h, int pitch) {
+    if (!texture || !pixels || w <= 0 || h <= 0) return;
+
+    int idx = findTexture(texture);
+    if (idx < 0) {
+        if (gTextureCount == gTextureCapacity) {
+            int newCap = gTextureCapacity > 0 ? gTextureCapacity * 2 : 8;
+            RasterTexture *grown = realloc(gTextures, (size_t)newCap * sizeof(RasterTexture));
+            if (!grown) return;
+            gTextures = grown;
+            gTextureCapacity = newCap;
+        }
+        idx = gTextureCount++;
+        gTextures[idx] = (RasterTexture){texture, NULL, 0, 0};
+    }
+
+    RasterTexture *t = &gTextures[idx];
+    Uint8 *copy = malloc((size_t)w * h * 4);
+    if (!copy) return;
+    for (int y = 0; y < h; y++) {
+        memcpy(copy + (size_t)y * w * 4, (const Uint8 *)pixels + (size_t)y * pitch, (size_t)w * 4);
+    }
+    free(t->pixels);
+    t->pixels = copy;
+    t->w = w;
+    t->h = h;
+}
+
+void raster3dBeginFrame(int width, int height) {
+    if (width <= 0 || height <= 0) return;
+
+    if (width != gWidth || height != gHeight) {
+        Uint32 *color = malloc((size_t)width * height * sizeof(Uint32));
+        float *depth = malloc((size_t)width * height * sizeof(float));
+        int tilesX = (width + RASTER3D_TILE - 1) / RASTER3D_TILE;
+        int tilesY = (height + RASTER3D_TILE - 1) / RASTER3D_TILE;
+        RasterBin *bins = calloc((size_t)tilesX * tilesY, sizeof(RasterBin));
+        if (!color || !depth || !bins) {
+            free(color); free(depth); free(bins);
+            return;
+        }
+        for (int i = 0; i < gBinCount; i++) free(gBins[i].tris);
+        free(gColor); free(gDepth); free(gBins);
+        gColor = color;
+        gDepth = depth;
+        gBins = bins;
+        gBinCount = tilesX * tilesY;
+        gTilesX = tilesX;
+        gTilesY = tilesY;
+        gWidth = width;
+        gHeight = height;
+    }
+
+    gTriCount = 0;
+    for (int i = 0; i < gBinCount; i++) gBins[i].count = 0;
+}
+
+static int binAppend(RasterBin *bin, int tri) {
+    if (bin->count == bin->capacity) {
+        int newCap = bin->capacity > 0 ? bin->capacity * 2 : 64;
+        int *grown = realloc(bin->tris, (size_t)newCap * sizeof(int));
+        if (!grown) return 0;
+        bin->tris = grown;
+        bin->capacity = newCap;
+    }
+    bin->tris[bin->count++] = tri;
+    return 1;
+}
+
+void raster3dTriangle(const Raster3DVertex *a, const Raster3DVertex *b, const Raster3DVertex *c, SDL_Texture *texture) {
+    if (!gColor || !a || !b || !c) return;
+
+    // Make the winding positive so "inside" is the same test for every
+    // triangle; culling has already happened upstream.
+    const Raster3DVertex *v[3] = {a, b, c};
+    Sint64 fx[3], fy[3];
+    for (int i = 0; i < 3; i++) {
+        float x = fmaxf(-COORD_LIMIT, fminf(COORD_LIMIT, v[i]->sx));
+        float y = fmaxf(-COORD_LIMIT, fminf(COORD_LIMIT, v[i]->sy));
+        if (x != x || y != y) return;
+        fx[i] = (Sint64)lrintf(x * SUBPIXEL);
+        fy[i] = (Sint64)lrintf(y * SUBPIXEL);
+    }
+    Sint64 area = (fx[1] - fx[0]) * (fy[2] - fy[0]) - (fy[1] - fy[0]) * (fx[2] - fx[0]);
+    if (area == 0) return;
+    if (area < 0) {
+        const Raster3DVertex *tv = v[1]; v[1] = v[2]; v[2] = tv;
+        Sint64 tx = fx[1]; fx[1] = fx[2]; fx[2] = tx;
+        Sint64 ty = fy[1]; fy[1] = fy[2]; fy[2] = ty;
+        area = -area;
+    }
+
+    float minXf = fminf(v[0]->sx, fminf(v[1]->sx, v[2]->sx));
+    float maxXf = fmaxf(v[0]->sx, fmaxf(v[1]->sx, v[2]->sx));
+    float minYf = fminf(v[0]->sy, fminf(v[1]->sy, v[2]->sy));
+    float maxYf = fmaxf(v[0]->sy, fmaxf(v[1]->sy, v[2]->sy));
+    if (maxXf < 0.0f || maxYf < 0.0f || minXf >= (float)gWidth || minYf >= (float)gHeight) return;
+
+    if (gTriCount == gTriCapacity) {
+        int newCap = gTriCapacity > 0 ? gTriCapacity * 2 : 1024;
+        RasterTri *grown = realloc(gTris, (size_t)newCap * sizeof(RasterTri));
+        if (!grown) return;
+        gTris = grown;
+        gTriCapacity = newCap;
+    }
+    RasterTri *t = &gTris[gTriCount];
+
+    Sint64 unbiased[3];
+    for (int i = 0; i < 3; i++) {
+        int p = (i + 1) % 3, q = (i + 2) % 3;
+        t->a[i] = fy[p] - fy[q];
+        t->b[i] = fx[q] - fx[p];
+        unbiased[i] = -(t->a[i] * fx[p] + t->b[i] * fy[p]);
+        int owns = t->a[i] > 0 || (t->a[i] == 0 && t->b[i] > 0);
+        t->c[i] = owns ? unbiased[i] : unbiased[i] - 1;
+    }
+
+    float values[3][ATTR_COUNT];
+    for (int i = 0; i < 3; i++) {
+        float w = 1.0f / v[i]->z;
+        values[i][ATTR_W] = w;
+        values[i][ATTR_U] = v[i]->u * w;
+        values[i][ATTR_V] = v[i]->v * w;
+        values[i][ATTR_R] = v[i]->color.r * w;
+        values[i][ATTR_G] = v[i]->color.g * w;
+        values[i][ATTR_B] = v[i]->color.b * w;
+        values[i][ATTR_A] = v[i]->color.a * w;
+    }
+    // Barycentric weight i is edge function i / area; planes are set up in
+    // double since the subpixel products exceed float precision.
+    double invArea = 1.0 / (double)area;
+    for (int k = 0; k < ATTR_COUNT; k++) {
+        double dx = 0.0, dy = 0.0, c0 = 0.0;
+        for (int i = 0; i < 3; i++) {
+            dx += values[i][k] * (double)t->a[i];
+            dy += values[i][k] * (double)t->b[i];
+            c0 += values[i][k] * (double)unbiased[i];
+        }
+        t->attr[k].dx = (float)(dx * SUBPIXEL * invArea);
+        t->attr[k].dy = (float)(dy * SUBPIXEL * invArea);
+        t->attr[k].c = (float)(c0 * invArea);
+    }
+
+    t->minX = minXf > 0.0f ? (int)minXf : 0;
+    t->minY = minYf > 0.0f ? (int)minYf : 0;
+    t->maxX = maxXf < (float)(gWidth - 1) ? (int)maxXf : gWidth - 1;
+    t->maxY = maxYf < (float)(gHeight - 1) ? (int)maxYf : gHeight - 1;
+    t->texture = findTexture(texture);
+
+    int tri = gTriCount++;
+    for (int ty = t->minY / RASTER3D_TILE; ty <= t->maxY / RASTER3D_TILE; ty++) {
+        for (int tx = t->minX / RASTER3D_TILE; tx <= t->maxX / RASTER3D_TILE; tx++) {
+            binAppend(&gBins[ty * gTilesX + tx], tri);
+        }
+    }
+}
+
+static void rasterTriangle(const RasterTri *t, int x0, int y0, int x1, int y1) {
+    int minX = t->minX > x0 ? t->minX : x0;
+    int minY = t->minY > y0 ? t->minY : y0;
+    int maxX = t->maxX < x1 ? t->maxX : x1;
+    int maxY = t->maxY < y1 ? t->maxY : y1;
+    const RasterTexture *tex = t->texture >= 0 ? &gTextures[t->texture] : NULL;
+    if (tex && !tex->pixels) tex = NULL;
+
+    for (int y = minY; y <= maxY; y++) {
+        Sint64 fy = (Sint64)y * SUBPIXEL + SUBPIXEL / 2;
+        Sint64 fx0 = (Sint64)minX * SUBPIXEL + SUBPIXEL / 2;
+
+        // Narrow the row to the span between the edges (with a pixel of
+        // slack; the exact test below still decides each pixel).
+        int spanMin = minX, spanMax = maxX;
+        for (int i = 0; i < 3; i++) {
+            double e0 = (double)(t->a[i] * fx0 + t->b[i] * fy + t->c[i]);
+            double step = (double)t->a[i] * SUBPIXEL;
+            if (t->a[i] > 0) {
+                double first = (double)minX + floor(-e0 / step);
+                if (first > (double)spanMin) spanMin = first > (double)maxX ? maxX + 1 : (int)first;
+            } else if (t->a[i] < 0) {
+                double last = (double)minX + ceil(e0 / -step);
+                if (last < (double)spanMax) spanMax = last < (double)minX ? minX - 1 : (int)last;
+            } else if (e0 < 0.0) {
+                spanMax = spanMin - 1;
+            }
+        }
+        if (spanMin > spanMax) continue;
+
+        Sint64 fx = (Sint64)spanMin * SUBPIXEL + SUBPIXEL / 2;
+        Sint64 e[3], step[3];
+        for (int i = 0; i < 3; i++) {
+            e[i] = t->a[i] * fx + t->b[i] * fy + t->c[i];
+            step[i] = t->a[i] * SUBPIXEL;
+        }
+        float px = (float)spanMin + 0.5f, py = (float)y + 0.5f;
+        float attr[ATTR_COUNT];
+        for (int k = 0; k < ATTR_COUNT; k++) attr[k] = t->attr[k].dx * px + t->attr[k].dy * py + t->attr[k].c;
+
+        Uint8 *row = (Uint8 *)(gColor + (size_t)y * gWidth);
+        float *zrow = gDepth + (size_t)y * gWidth;
+        for (int x = spanMin; x <= spanMax; x++) {
+            int inside = (e[0] | e[1] | e[2]) >= 0;
+
+            // Depth is W = 1 / z: larger is nearer, cleared to 0.
+            if (inside && attr[ATTR_W] > zrow[x]) {
+                float z = 1.0f / attr[ATTR_W];
+                Uint8 texel[4] = {255, 255, 255, 255};
+                if (tex) {
+                    float u = attr[ATTR_U] * z, v = attr[ATTR_V] * z;
+                    int tu = (int)floorf((u - floorf(u)) * (float)tex->w);
+                    int tv = (int)floorf((v - floorf(v)) * (float)tex->h);
+                    if (tu >= tex->w) tu = tex->w - 1;
+                    if (tv >= tex->h) tv = tex->h - 1;
+                    memcpy(texel, tex->pixels + ((size_t)tv * tex->w + tu) * 4, 4);
+                }
+
+                float scale = z * (1.0f / 255.0f);
+                int alpha = (int)(texel[3] * attr[ATTR_A] * scale);
+                if (alpha > 0) {
+                    Uint8 *out = row + (size_t)x * 4;
+                    out[0] = (Uint8)fminf(255.0f, texel[0] * attr[ATTR_R] * scale);
+                    out[1] = (Uint8)fminf(255.0f, texel[1] * attr[ATTR_G] * scale);
+                    out[2] = (Uint8)fminf(255.0f, texel[2] * attr[ATTR_B] * scale);
+                    out[3] = (Uint8)(alpha < 255 ? alpha : 255);
+                    zrow[x] = attr[ATTR_W];
+                }
+            }
+
+            for (int i = 0; i < 3; i++) e[i] += step[i];
+            for (int k = 0; k < ATTR_COUNT; k++) attr[k] += t->attr[k].dx;
+        }
+    }
+}
+
+// Clears the tile, then draws its triangles in submission order.
+static void rasterTile(int tile) {
+    int x0 = (tile % gTilesX) * RASTER3D_TILE;
+    int y0 = (tile / gTilesX) * RASTER3D_TILE;
+    int x1 = x0 + RASTER3D_TILE < gWidth ? x0 + RASTER3D_TILE : gWidth;
+    int y1 = y0 + RASTER3D_TILE < gHeight ? y0 + RASTER3D_TILE : gHeight;
+
+    for (int y = y0; y < y1; y++) {
+        memset(gColor + (size_t)y * gWidth + x0, 0, (size_t)(x1 - x0) * sizeof(Uint32));
+        memset(gDepth + (size_t)y * gWidth + x0, 0, (size_t)(x1 - x0) * sizeof(float));
+    }
+
+    const RasterBin *bin = &gBins[tile];
+    for (int i = 0; i < bin->count; i++) {
+        rasterTriangle(&gTris[bin->tris[i]], x0, y0, x1 - 1, y1 - 1);
+    }
+}
+
+static void rasterTiles(void) {
+    int tile;
+    while ((tile = SDL_AtomicAdd(&gNextTile, 1)) < gBinCount) rasterTile(tile);
+}
+
+static int workerMain(void *data) {
+    (void)data;
+    for (;;) {
+        SDL_SemWait(gStartSem);
+        if (gQuit) break;
+        rasterTiles();
+        SDL_SemPost(gDoneSem);
+    }
+    return 0;
+}
+
+static int wantedThreads(void) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 1;
+#else
+    int count = gThreadRequest > 0 ? gThreadRequest : SDL_GetCPUCount();
+    if (count < 1) count = 1;
+    if (count > RASTER3D_MAX_THREADS) count = RASTER3D_MAX_THREADS;
+    return count;
+#endif
+}
+
+static void stopWorkers(void) {
+    gQuit = 1;
+    for (int i = 0; i < gWorkerCount; i++) SDL_SemPost(gStartSem);
+    for (int i = 0; i < gWorkerCount; i++) SDL_WaitThread(gWorkers[i], NULL);
+    if (gStartSem) SDL_DestroySemaphore(gStartSem);
+    if (gDoneSem) SDL_DestroySemaphore(gDoneSem);
+    gStartSem = gDoneSem = NULL;
+    gWorkerCount = 0;
+    gWorkersStarted = 0;
+    gQuit = 0;
+}
+
+// Falls back to fewer (or no) helpers when threads can't be created.
+static void startWorkers(void) {
+    gWorkersStarted = 1;
+    int helpers = wantedThreads() - 1;
+    if (helpers <= 0) return;
+
+    gStartSem = SDL_CreateSemaphore(0);
+    gDoneSem = SDL_CreateSemaphore(0);
+    if (!gStartSem || !gDoneSem) {
+        stopWorkers();
+        gWorkersStarted = 1;
+        return;
+    }
+    while (gWorkerCount < helpers) {
+        SDL_Thread *thread = SDL_CreateThread(workerMain, "raster3d", NULL);
+        if (!thread) break;
+        gWorkers[gWorkerCount++] = thread;
+    }
+}
+
+void raster3dSetThreadCount(int count) {
+    if (count < 0) count = 0;
+    if (count == gThreadRequest) return;
+    gThreadRequest = count;
+    if (gWorkersStarted) stopWorkers();
+}
+
+int raster3dGetThreadCount(void) {
+    return gWorkersStarted ? gWorkerCount + 1 : wantedThreads();
+}
+
+void raster3dShutdown(void) {
+    stopWorkers();
+}
+
+static void upload(SDL_Renderer *renderer) {
+    if (!gTarget || gTargetW != gWidth || gTargetH != gHeight) {
+        if (gTarget) SDL_DestroyTexture(gTarget);
+        gTarget = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, gWidth, gHeight);
+        if (!gTarget) return;
+        SDL_SetTextureBlendMode(gTarget, SDL_BLENDMODE_BLEND);
+        gTargetW = gWidth;
+        gTargetH = gHeight;
+    }
+
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(gTarget, NULL, &pixels, &pitch) != 0) return;
+    for (int y = 0; y < gHeight; y++) {
+        memcpy((Uint8 *)pixels + (size_t)y * pitch, gColor + (size_t)y * gWidth, (size_t)gWidth * sizeof(Uint32));
+    }
+    SDL_UnlockTexture(gTarget);
+
+    SDL_Rect dst = {0, 0, gWidth, gHeight};
+    SDL_RenderCopy(renderer, gTarget, NULL, &dst);
+}
+
+void raster3dEndFrame(SDL_Renderer *renderer) {
+    if (!gColor) return;
+    if (!gWorkersStarted) startWorkers();
+
+    SDL_AtomicSet(&gNextTile, 0);
+    for (int i = 0; i < gWorkerCount; i++) SDL_SemPost(gStartSem);
+    rasterTiles();
+    for (int i = 0; i < gWorkerCount; i++) SDL_SemWait(gDoneSem);
+
+    if (renderer) upload(renderer);
+}
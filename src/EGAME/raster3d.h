@@ -0,0 +1,38 @@
+#ifndef RASTER3D_H
+#define RASTER3D_H
+
+#include <SDL.h>
+
+// Tile-binned software rasterizer behind render3d's software backend.
+// Triangles are binned into RASTER3D_TILE x RASTER3D_TILE screen tiles as
+// they are submitted; raster3dEndFrame rasterizes the tiles on worker
+// threads with a 32-bit depth buffer and perspective-correct attributes,
+// then uploads the result into one streaming texture.
+#define RASTER3D_TILE 32
+#define RASTER3D_MAX_THREADS 16
+
+// Screen position, view depth (> 0), texture coords and vertex color.
+typedef struct {
+    float sx, sy, z;
+    float u, v;
+    SDL_Color color;
+} Raster3DVertex;
+
+// CPU copy of a texture's RGBA32 pixels; textures without one render
+// with vertex color only.
+void raster3dSetTexturePixels(SDL_Texture *texture, const void *pixels, int w, int h, int pitch);
+
+void raster3dBeginFrame(int width, int height);
+void raster3dTriangle(const Raster3DVertex *a, const Raster3DVertex *b, const Raster3DVertex *c, SDL_Texture *texture);
+// Rasterizes the frame and copies it over the renderer's current target.
+// Pixels nothing was drawn to stay transparent.
+void raster3dEndFrame(SDL_Renderer *renderer);
+
+// Total threads used for rasterizing, including the calling thread.
+// 0 picks one per CPU.
+void raster3dSetThreadCount(int count);
+int raster3dGetThreadCount(void);
+// Joins the worker threads; the next frame starts them again.
+void raster3dShutdown(void);
+
+#endif
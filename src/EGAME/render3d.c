@@ -1,9 +1,66 @@
 #include "render3d.h"
+#include "hiz3d.h"
+#include "raster3d.h"
+#include "xform3d.h"
 #include "../MENGINE/renderer.h"
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 static Camera3D gCamera = {{0.0f, 0.0f, 0.0f}, 0.0f, 0.0f, 75.0f * (float)M_PI / 180.0f};
+static Render3DView gView;
+static int gViewValid = 0;
+
+// Push the near plane out a bit so geometry right under the camera
+// doesn't blow up from the perspective divide.
+static const float NEAR_PLANE = 0.2f;
+static float gFarPlane = 100.0f;
+static float gGuardBand = 1.5f;
+static Render3DClipMode gClipMode = RENDER3D_CLIP_NEAR;
+static Uint32 gFrameIndex = 0;
+static Render3DBackend gBackend = RENDER3D_BACKEND_SDL;
+static Render3DBackend gFrameBackend = RENDER3D_BACKEND_SDL;
+
+// Distance shading, per output vertex: scale / (bias + depth), clamped to
+// [minShade, 1]. Off while scale is 0.
+static float gShadeScale = 0.0f;
+static float gShadeBias = 0.0f;
+static float gShadeMin = 1.0f;
+
+static Render3DCullStats gCullStats = {0};
+static Render3DCullStats gLastCullStats = {0};
+
+// Every 3D vertex and index of a frame is written into one growable arena
+// that is only reset at frame start, so steady-state frames do no
+// allocations. The high-water marks tell callers how much to reserve.
+typedef struct {
+    SDL_Vertex *verts;
+    int count;
+    int capacity;
+    int highWater;
+    Render3DIndex *indices;
+    int indexCount;
+    int indexCapacity;
+    int indexHighWater;
+} Render3DArena;
+
+// Faces drawn between render3dBeginFrame/render3dEndFrame are appended to the
+// arena and only submitted when the texture changes (or the frame ends), so
+// painter order is kept while the draw call count drops to one per texture
+// run. A batch is the arena ranges [start, count) and [indexStart,
+// indexCount); its indices are relative to start.
+typedef struct {
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;
+    int start;
+    int indexStart;
+    int active;
+    int drawCalls;
+    int lastDrawCalls;
+} Render3DBatch;
+
+static Render3DArena gArena = {0};
+static Render3DBatch gBatch = {0};
 
 Vec3 v3(float x, float y, float z) { Vec3 v = {x, y, z}; return v; }
 Vec3 v3_add(Vec3 a, Vec3 b) { return v3(a.x + b.x, a.y + b.y, a.z + b.z); }
@@ -36,8 +93,112 @@ static Vec3 rotateVector(Vec3 v, Vec3 rot) {
     return v3(x3, y3, z2);
 }
 
-void render3dSetCamera(Camera3D cam) { gCamera = cam; }
-Camera3D render3dGetCamera(void) { return gCamera; }
+Mat34 render3dMat34FromTransform(Vec3 position, Vec3 rotation) {
+    // Columns are the rotated basis vectors, so applying the matrix matches
+    // rotateVector() followed by the translation.
+    Vec3 cx = rotateVector(v3(1.0f, 0.0f, 0.0f), rotation);
+    Vec3 cy = rotateVector(v3(0.0f, 1.0f, 0.0f), rotation);
+    Vec3 cz = rotateVector(v3(0.0f, 0.0f, 1.0f), rotation);
+    Mat34 m = {{
+        {cx.x, cy.x, cz.x, position.x},
+        {cx.y, cy.y, cz.y, position.y},
+        {cx.z, cy.z, cz.z, position.z},
+    }};
+    return m;
+}
+
+Vec3 render3dMat34Apply(const Mat34 *m, Vec3 v) {
+    if (!m) return v;
+    return v3(m->m[0][0] * v.x + m->m[0][1] * v.y + m->m[0][2] * v.z + m->m[0][3],
+              m->m[1][0] * v.x + m->m[1][1] * v.y + m->m[1][2] * v.z + m->m[1][3],
+              m->m[2][0] * v.x + m->m[2][1] * v.y + m->m[2][2] * v.z + m->m[2][3]);
+}
+
+static int isZeroVec(Vec3 v) { return v.x == 0.0f && v.y == 0.0f && v.z == 0.0f; }
+static int sameVec(Vec3 a, Vec3 b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+void render3dSetInstanceTransform(MeshInstance *inst, Vec3 position, Vec3 rotation) {
+    if (!inst) return;
+    inst->position = position;
+    inst->rotation = rotation;
+    render3dInstanceWorld(inst);
+}
+
+const Mat34 *render3dInstanceWorld(MeshInstance *inst) {
+    if (!inst) return NULL;
+    if (!inst->worldValid || !sameVec(inst->position, inst->worldPosition) || !sameVec(inst->rotation, inst->worldRotation)) {
+        inst->worldPosition = inst->position;
+        inst->worldRotation = inst->rotation;
+        inst->worldIdentity = isZeroVec(inst->position) && isZeroVec(inst->rotation);
+        if (!inst->worldIdentity) inst->world = render3dMat34FromTransform(inst->position, inst->rotation);
+        inst->worldValid = 1;
+        render3dInstanceUpdateBounds(inst);
+    }
+    return inst->worldIdentity ? NULL : &inst->world;
+}
+
+// World AABB and sphere from the local AABB.
+static void updateWorldBounds(MeshInstance *inst) {
+    // Rotated box: centre goes through the matrix, extents through |M|.
+    Vec3 c = v3_scale(v3_add(inst->boundsMin, inst->boundsMax), 0.5f);
+    Vec3 e = v3_scale(v3_sub(inst->boundsMax, inst->boundsMin), 0.5f);
+    if (inst->worldValid && !inst->worldIdentity) {
+        const float (*m)[4] = inst->world.m;
+        c = render3dMat34Apply(&inst->world, c);
+        e = v3(fabsf(m[0][0]) * e.x + fabsf(m[0][1]) * e.y + fabsf(m[0][2]) * e.z,
+               fabsf(m[1][0]) * e.x + fabsf(m[1][1]) * e.y + fabsf(m[1][2]) * e.z,
+               fabsf(m[2][0]) * e.x + fabsf(m[2][1]) * e.y + fabsf(m[2][2]) * e.z);
+    }
+    inst->worldMin = v3_sub(c, e);
+    inst->worldMax = v3_add(c, e);
+    inst->boundsCenter = c;
+    inst->boundsRadius = sqrtf(v3_dot(e, e));
+}
+
+void render3dInstanceUpdateBounds(MeshInstance *inst) {
+    if (!inst) return;
+    const Mesh *mesh = &inst->mesh;
+    Vec3 mn = v3(0.0f, 0.0f, 0.0f), mx = mn, sum = mn;
+    int count = mesh->verts ? mesh->vertCount : 0;
+    for (int i = 0; i < count; i++) {
+        Vec3 p = mesh->verts[i];
+        sum = v3_add(sum, p);
+        if (i == 0) { mn = mx = p; continue; }
+        mn = v3(fminf(mn.x, p.x), fminf(mn.y, p.y), fminf(mn.z, p.z));
+        mx = v3(fmaxf(mx.x, p.x), fmaxf(mx.y, p.y), fmaxf(mx.z, p.z));
+    }
+    inst->boundsMin = mn;
+    inst->boundsMax = mx;
+
+    // Vertex centroid: the average vertex depth is the centroid's depth.
+    Vec3 centroid = count > 0 ? v3_scale(sum, 1.0f / (float)count) : sum;
+    float radius2 = 0.0f;
+    for (int i = 0; i < count; i++) {
+        Vec3 d = v3_sub(mesh->verts[i], centroid);
+        radius2 = fmaxf(radius2, v3_dot(d, d));
+    }
+    inst->centroid = centroid;
+    inst->centroidRadius = sqrtf(radius2);
+    inst->worldCentroid = inst->worldValid && !inst->worldIdentity ?
+                          render3dMat34Apply(&inst->world, centroid) : centroid;
+    updateWorldBounds(inst);
+}
+
+void render3dInstanceExtendBounds(MeshInstance *inst, Vec3 min, Vec3 max) {
+    if (!inst) return;
+    render3dInstanceWorld(inst);
+    inst->boundsMin = v3(fminf(inst->boundsMin.x, min.x), fminf(inst->boundsMin.y, min.y), fminf(inst->boundsMin.z, min.z));
+    inst->boundsMax = v3(fmaxf(inst->boundsMax.x, max.x), fmaxf(inst->boundsMax.y, max.y), fmaxf(inst->boundsMax.z, max.z));
+    updateWorldBounds(inst);
+}
+
+// Per-call transforms build one matrix instead of doing trig per vertex;
+// a zero transform means the mesh is already in world space.
+static const Mat34 *callTransform(Mat34 *scratch, Vec3 position, Vec3 rotation) {
+    if (isZeroVec(position) && isZeroVec(rotation)) return NULL;
+    *scratch = render3dMat34FromTransform(position, rotation);
+    return scratch;
+}
 
 static void cameraBasis(Vec3 *forward, Vec3 *right, Vec3 *upVec) {
     Vec3 f = v3(cosf(gCamera.yaw) * cosf(gCamera.pitch), sinf(gCamera.pitch), sinf(gCamera.yaw) * cosf(gCamera.pitch));
@@ -48,193 +209,1291 @@ static void cameraBasis(Vec3 *forward, Vec3 *right, Vec3 *upVec) {
     if (upVec) *upVec = u;
 }
 
-float render3dMeshDepth(const Mesh *mesh, Vec3 position, Vec3 rotation) {
+static void viewRow(float row[4], Vec3 axis, float scale, Vec3 origin) {
+    row[0] = axis.x * scale;
+    row[1] = axis.y * scale;
+    row[2] = axis.z * scale;
+    row[3] = -v3_dot(axis, origin) * scale;
+}
+
+static void updateView(void) {
+    Render3DView *vw = &gView;
+    cameraBasis(&vw->forward, &vw->right, &vw->up);
+    vw->position = gCamera.position;
+    vw->width = (float)WINW;
+    vw->height = (float)WINH;
+    vw->aspect = vw->width / vw->height;
+    vw->focal = 1.0f / tanf(gCamera.fov * 0.5f);
+
+    viewRow(vw->viewProj.m[0], vw->right, vw->focal / vw->aspect, vw->position);
+    viewRow(vw->viewProj.m[1], vw->up, vw->focal, vw->position);
+    viewRow(vw->viewProj.m[2], vw->forward, 1.0f, vw->position);
+
+    // Frustum planes straight from the clip rows: x >= -w, x <= w, ...
+    vw->nearPlane = NEAR_PLANE;
+    vw->farPlane = gFarPlane;
+    vw->guardBand = gGuardBand;
+    const float *rx = vw->viewProj.m[0], *ry = vw->viewProj.m[1], *rw = vw->viewProj.m[2];
+    const float sign[4] = {1.0f, -1.0f, 1.0f, -1.0f};
+    for (int p = 0; p < 4; p++) {
+        const float *r = p < 2 ? rx : ry;
+        float a = rw[0] + sign[p] * r[0], b = rw[1] + sign[p] * r[1], c = rw[2] + sign[p] * r[2];
+        float d = rw[3] + sign[p] * r[3];
+        float len = sqrtf(a * a + b * b + c * c);
+        if (len > 0.0f) { a /= len; b /= len; c /= len; d /= len; }
+        vw->frustum[p] = (Plane3D){v3(a, b, c), d};
+    }
+    vw->frustum[4] = (Plane3D){v3(rw[0], rw[1], rw[2]), rw[3] - vw->nearPlane};
+    vw->frustum[5] = (Plane3D){v3(-rw[0], -rw[1], -rw[2]), vw->farPlane - rw[3]};
+    gViewValid = 1;
+}
+
+void render3dSetFarPlane(float farPlane) {
+    gFarPlane = farPlane > NEAR_PLANE ? farPlane : NEAR_PLANE + 1.0f;
+    if (gViewValid) updateView();
+}
+
+void render3dSetClipMode(Render3DClipMode mode) { gClipMode = mode; }
+
+void render3dSetGuardBand(float guardBand) {
+    gGuardBand = guardBand >= 1.0f ? guardBand : 1.0f;
+    if (gViewValid) updateView();
+}
+
+void render3dSetCamera(Camera3D cam) {
+    gCamera = cam;
+    updateView();
+}
+
+Camera3D render3dGetCamera(void) { return gCamera; }
+
+const Render3DView *render3dGetView(void) {
+    if (!gViewValid) updateView();
+    return &gView;
+}
+
+Mat34 render3dMat34Mul(const Mat34 *a, const Mat34 *b) {
+    Mat34 r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            r.m[i][j] = a->m[i][0] * b->m[0][j] + a->m[i][1] * b->m[1][j] + a->m[i][2] * b->m[2][j];
+        }
+        r.m[i][3] += a->m[i][3];
+    }
+    return r;
+}
+
+// Model-view-projection for one draw: the shared view block, optionally
+// combined with the mesh's world matrix.
+static Mat34 drawTransform(const Mat34 *world) {
+    const Render3DView *vw = render3dGetView();
+    return world ? render3dMat34Mul(&vw->viewProj, world) : vw->viewProj;
+}
+
+static int arenaReserve(int count) {
+    if (count <= gArena.capacity) return 1;
+
+    int newCap = gArena.capacity > 0 ? gArena.capacity : 4096;
+    while (count > newCap) newCap *= 2;
+
+    SDL_Vertex *grown = realloc(gArena.verts, (size_t)newCap * sizeof(SDL_Vertex));
+    if (!grown) return 0;
+
+    gArena.verts = grown;
+    gArena.capacity = newCap;
+    return 1;
+}
+
+static int arenaReserveIndices(int count) {
+    if (count <= gArena.indexCapacity) return 1;
+
+    int newCap = gArena.indexCapacity > 0 ? gArena.indexCapacity : 8192;
+    while (count > newCap) newCap *= 2;
+
+    Render3DIndex *grown = realloc(gArena.indices, (size_t)newCap * sizeof(Render3DIndex));
+    if (!grown) return 0;
+
+    gArena.indices = grown;
+    gArena.indexCapacity = newCap;
+    return 1;
+}
+
+void render3dReserveVertices(int count) {
+    arenaReserve(count);
+    arenaReserveIndices(count * 2);
+}
+
+int render3dGetVertexHighWater(void) { return gArena.highWater; }
+int render3dGetIndexHighWater(void) { return gArena.indexHighWater; }
+
+int render3dFrustumTestSphere(Vec3 center, float radius) {
+    const Render3DView *vw = render3dGetView();
+    for (int p = 0; p < 6; p++) {
+        if (v3_dot(vw->frustum[p].n, center) + vw->frustum[p].d < -radius) return 0;
+    }
+    return 1;
+}
+
+int render3dFrustumTestAABB(Vec3 min, Vec3 max) {
+    const Render3DView *vw = render3dGetView();
+    for (int p = 0; p < 6; p++) {
+        // Corner furthest along the plane normal decides.
+        const Plane3D *pl = &vw->frustum[p];
+        Vec3 corner = v3(pl->n.x >= 0.0f ? max.x : min.x,
+                         pl->n.y >= 0.0f ? max.y : min.y,
+                         pl->n.z >= 0.0f ? max.z : min.z);
+        if (v3_dot(pl->n, corner) + pl->d < 0.0f) return 0;
+    }
+    return 1;
+}
+
+int render3dInstanceVisible(MeshInstance *inst) {
+    if (!inst) return 0;
+    render3dInstanceWorld(inst);
+    int visible = render3dFrustumTestSphere(inst->boundsCenter, inst->boundsRadius) &&
+                  render3dFrustumTestAABB(inst->worldMin, inst->worldMax);
+    if (visible) gCullStats.visible++;
+    else gCullStats.culled++;
+    return visible;
+}
+
+Render3DCullStats render3dGetCullStats(void) { return gLastCullStats; }
+
+void render3dAddOccluder(MeshInstance *inst) {
+    if (!inst) return;
+    hiz3dAddMesh(&inst->mesh, render3dInstanceWorld(inst));
+}
+
+int render3dInstanceOccluded(MeshInstance *inst) {
+    if (!inst) return 0;
+    render3dInstanceWorld(inst);
+    int occluded = hiz3dOccludedAABB(inst->worldMin, inst->worldMax);
+    if (occluded) gCullStats.occluded++;
+    else gCullStats.unoccluded++;
+    return occluded;
+}
+
+void render3dBeginFrame(SDL_Renderer *renderer) {
+    if (gBatch.active) render3dEndFrame();
+    gArena.count = 0;
+    gArena.indexCount = 0;
+    gBatch.renderer = renderer;
+    gBatch.texture = NULL;
+    gBatch.start = 0;
+    gBatch.indexStart = 0;
+    gBatch.drawCalls = 0;
+    gBatch.active = 1;
+    if (++gFrameIndex == 0) gFrameIndex = 1;
+    gCullStats = (Render3DCullStats){0};
+
+    hiz3dBegin(render3dGetView());
+
+    gFrameBackend = gBackend;
+    if (gFrameBackend == RENDER3D_BACKEND_SOFTWARE) {
+        const Render3DView *vw = render3dGetView();
+        raster3dBeginFrame((int)vw->width, (int)vw->height);
+    }
+}
+
+void render3dSetBackend(Render3DBackend backend) { gBackend = backend; }
+Render3DBackend render3dGetBackend(void) { return gBackend; }
+
+void render3dSetDepthShading(float scale, float bias, float minShade) {
+    gShadeScale = scale > 0.0f ? scale : 0.0f;
+    gShadeBias = bias;
+    gShadeMin = minShade < 1.0f ? minShade : 1.0f;
+}
+
+static void dedupReset(void);
+
+void render3dFlush(void) {
+    int count = gArena.count - gBatch.start;
+    int indexCount = gArena.indexCount - gBatch.indexStart;
+    if (count > 0 && indexCount > 0 && gBatch.renderer) {
+        const SDL_Vertex *base = gArena.verts + gBatch.start;
+        SDL_RenderGeometryRaw(gBatch.renderer, gBatch.texture,
+                              &base->position.x, sizeof(SDL_Vertex),
+                              &base->color, sizeof(SDL_Vertex),
+                              &base->tex_coord.x, sizeof(SDL_Vertex),
+                              count, gArena.indices + gBatch.indexStart, indexCount, sizeof(Render3DIndex));
+        gBatch.drawCalls++;
+    }
+    gBatch.start = gArena.count;
+    gBatch.indexStart = gArena.indexCount;
+    if (gArena.count > gArena.highWater) gArena.highWater = gArena.count;
+    if (gArena.indexCount > gArena.indexHighWater) gArena.indexHighWater = gArena.indexCount;
+    // Dedup entries hold batch-relative indices.
+    dedupReset();
+}
+
+void render3dEndFrame(void) {
+    if (gFrameBackend == RENDER3D_BACKEND_SOFTWARE && gBatch.active) {
+        raster3dEndFrame(gBatch.renderer);
+        gBatch.drawCalls++;
+    }
+    render3dFlush();
+    gBatch.active = 0;
+    gBatch.lastDrawCalls = gBatch.drawCalls;
+    gLastCullStats = gCullStats;
+}
+
+int render3dGetDrawCalls(void) { return gBatch.lastDrawCalls; }
+
+static float pointDepth(const Render3DView *vw, Vec3 p) {
+    const float *row = vw->viewProj.m[2];
+    return row[0] * p.x + row[1] * p.y + row[2] * p.z + row[3];
+}
+
+static float meshDepth(const Mesh *mesh, const Mat34 *world) {
     if (!mesh || !mesh->verts || mesh->vertCount == 0) return 0.0f;
-    Vec3 forward;
-    cameraBasis(&forward, NULL, NULL);
+    Vec3 sum = v3(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < mesh->vertCount; i++) sum = v3_add(sum, mesh->verts[i]);
+    Vec3 centroid = render3dMat34Apply(world, v3_scale(sum, 1.0f / (float)mesh->vertCount));
+    return pointDepth(render3dGetView(), centroid);
+}
+
+float render3dMeshDepth(const Mesh *mesh, Vec3 position, Vec3 rotation) {
+    Mat34 scratch;
+    return meshDepth(mesh, callTransform(&scratch, position, rotation));
+}
+
+float render3dInstanceDepth(MeshInstance *inst) {
+    if (!inst) return 0.0f;
+    render3dInstanceWorld(inst);
+    return pointDepth(render3dGetView(), inst->worldCentroid);
+}
+
+void render3dDepthKeys(const float *x, const float *y, const float *z, int count, float *out) {
+    const float *row = render3dGetView()->viewProj.m[2];
+    const float r0 = row[0], r1 = row[1], r2 = row[2], r3 = row[3];
+    for (int i = 0; i < count; i++) out[i] = r0 * x[i] + r1 * y[i] + r2 * z[i] + r3;
+}
+
+// View-space vertex flowing through clipping and subdivision: clip-space
+// x/y, view depth z, texture coords and the projected screen position.
+// src is the vertex-stream index for mesh corners, -1 for generated ones.
+typedef struct { float x, y, z, u, t, sx, sy; int src; } ViewVert;
+
+// Edge tessellation: an edge is split into 2^level pieces so that no piece
+// spans more than gMaxDepthRatio in view depth (affine texturing hides
+// perspective within that), up to gMaxSubdiv levels. TESS_HYSTERESIS is the
+// relative band an edge must leave before its cached level changes.
+#define TESS_MAX_LEVEL 4
+static int gMaxSubdiv = 3;
+static float gMaxDepthRatio = 1.35f;
+static const float TESS_HYSTERESIS = 0.2f;
+
+static VertexStream gStream = {0};
 
-    float depthSum = 0.0f;
-    for (int i = 0; i < mesh->vertCount; i++) {
-        Vec3 world = rotateVector(mesh->verts[i], rotation);
-        world = v3_add(world, position);
-        depthSum += v3_dot(v3_sub(world, gCamera.position), forward);
+// Same expression as the vertex kernel so both paths give identical bits.
+static void projectVert(ViewVert *p, const Render3DView *vw) {
+    p->sx = (p->x / p->z * 0.5f + 0.5f) * vw->width;
+    p->sy = (1.0f - (p->y / p->z * 0.5f + 0.5f)) * vw->height;
+}
+
+static int clipNear(const ViewVert *in, int inCount, ViewVert *out, int outMax, const Render3DView *vw) {
+    int outCount = 0;
+    for (int j = 0; j < inCount; j++) {
+        ViewVert cur = in[j];
+        ViewVert prev = in[(j + inCount - 1) % inCount];
+        int curInside = cur.z >= NEAR_PLANE;
+        int prevInside = prev.z >= NEAR_PLANE;
+
+        if (curInside != prevInside) {
+            float t = (NEAR_PLANE - prev.z) / (cur.z - prev.z);
+            ViewVert inter;
+            inter.x = prev.x + (cur.x - prev.x) * t;
+            inter.y = prev.y + (cur.y - prev.y) * t;
+            inter.z = NEAR_PLANE;
+            inter.u = prev.u + (cur.u - prev.u) * t;
+            inter.t = prev.t + (cur.t - prev.t) * t;
+            inter.src = -1;
+            projectVert(&inter, vw);
+            if (outCount < outMax) out[outCount++] = inter;
+        }
+
+        if (curInside) {
+            if (outCount < outMax) out[outCount++] = cur;
+        }
     }
-    return depthSum / (float)mesh->vertCount;
+    return outCount;
 }
 
-void drawMesh(SDL_Renderer *renderer, const Mesh *mesh, Vec3 position, Vec3 rotation, SDL_Color baseColor) {
-    if (!renderer || !mesh || !mesh->verts || mesh->indexCount % 3 != 0) return;
+// Generic Sutherland-Hodgman pass; plane is (px, py, pz, pw) over the
+// view vertex's (x, y, z, 1) with the inside at >= 0.
+static int clipPlane(const ViewVert *in, int inCount, ViewVert *out, int outMax, const float plane[4], const Render3DView *vw) {
+    int outCount = 0;
+    for (int j = 0; j < inCount; j++) {
+        const ViewVert *cur = &in[j];
+        const ViewVert *prev = &in[(j + inCount - 1) % inCount];
+        float dCur = plane[0] * cur->x + plane[1] * cur->y + plane[2] * cur->z + plane[3];
+        float dPrev = plane[0] * prev->x + plane[1] * prev->y + plane[2] * prev->z + plane[3];
+
+        if ((dCur >= 0.0f) != (dPrev >= 0.0f)) {
+            float t = dPrev / (dPrev - dCur);
+            ViewVert inter;
+            inter.x = prev->x + (cur->x - prev->x) * t;
+            inter.y = prev->y + (cur->y - prev->y) * t;
+            inter.z = prev->z + (cur->z - prev->z) * t;
+            inter.u = prev->u + (cur->u - prev->u) * t;
+            inter.t = prev->t + (cur->t - prev->t) * t;
+            inter.src = -1;
+            projectVert(&inter, vw);
+            if (outCount < outMax) out[outCount++] = inter;
+        }
+
+        if (dCur >= 0.0f) {
+            if (outCount < outMax) out[outCount++] = *cur;
+        }
+    }
+    return outCount;
+}
+
+// Far and guard-band side planes, applied after the near clip so every
+// intersection has a positive depth to project with.
+static int clipFrustum(ViewVert *poly, int count, int polyMax, const Render3DView *vw) {
+    const float g = vw->guardBand;
+    const float planes[5][4] = {
+        {0.0f, 0.0f, -1.0f, vw->farPlane},
+        {1.0f, 0.0f, g, 0.0f},
+        {-1.0f, 0.0f, g, 0.0f},
+        {0.0f, 1.0f, g, 0.0f},
+        {0.0f, -1.0f, g, 0.0f},
+    };
+    ViewVert tmp[12];
+    for (int p = 0; p < 5 && count >= 3; p++) {
+        count = clipPlane(poly, count, tmp, 12, planes[p], vw);
+        for (int k = 0; k < count && k < polyMax; k++) poly[k] = tmp[k];
+        if (count > polyMax) count = polyMax;
+    }
+    return count;
+}
 
-    int vertTotal = mesh->indexCount * 256; // generous room for clipping + subdivision
-    if (vertTotal < 256) vertTotal = 256;
+// Twice the signed screen area (y down); positive for clockwise on screen.
+static float polygonArea(const ViewVert *poly, int count) {
+    float area = 0.0f;
+    for (int j = 0; j < count; j++) {
+        const ViewVert *a = &poly[j];
+        const ViewVert *b = &poly[(j + 1) % count];
+        area += a->sx * b->sy - b->sx * a->sy;
+    }
+    return area;
+}
 
-    SDL_Vertex *verts = calloc((size_t)vertTotal, sizeof(SDL_Vertex));
-    if (!verts) return;
+// Output vertices are shared within a drawMesh call: clip-space corners and
+// subdivision midpoints are computed from the same inputs in the same way,
+// so identical bits mean the same vertex. The table maps those bits to a
+// batch-relative index; bumping the generation empties it.
+typedef struct {
+    Uint32 gen;
+    int index;
+    float key[5];
+} DedupEntry;
 
-    Vec3 forward, right, upVec;
-    cameraBasis(&forward, &right, &upVec);
-    // Push the near plane out a bit so geometry right under the camera
-    // doesn't blow up from the perspective divide.
-    const float NEAR_PLANE = 0.2f;
-    float aspect = (float)WINW / (float)WINH;
-    float f = 1.0f / tanf(gCamera.fov * 0.5f);
+static DedupEntry *gDedup = NULL;
+static int gDedupCap = 0;
+static int gDedupUsed = 0;
+static Uint32 gDedupGen = 1;
 
-    int v = 0;
-    for (int i = 0; i < mesh->indexCount; i += 3) {
-        typedef struct { float x, y, z, u, t; } ViewVert;
+static void dedupReset(void) {
+    gDedupUsed = 0;
+    if (++gDedupGen == 0) {
+        if (gDedup) memset(gDedup, 0, (size_t)gDedupCap * sizeof(DedupEntry));
+        gDedupGen = 1;
+    }
+}
+
+static Uint32 dedupHash(const float key[5]) {
+    Uint32 h = 2166136261u;
+    for (int i = 0; i < 5; i++) {
+        Uint32 bits;
+        memcpy(&bits, &key[i], sizeof(bits));
+        h = (h ^ bits) * 16777619u;
+        h ^= h >> 15;
+    }
+    return h;
+}
+
+static DedupEntry *dedupSlot(const float key[5]) {
+    Uint32 mask = (Uint32)gDedupCap - 1;
+    for (Uint32 i = dedupHash(key) & mask;; i = (i + 1) & mask) {
+        DedupEntry *e = &gDedup[i];
+        if (e->gen != gDedupGen || memcmp(e->key, key, sizeof(e->key)) == 0) return e;
+    }
+}
+
+// Keeps the table at most half full; returns 0 if it cannot grow.
+static int dedupGrow(void);
+
+// Batch-relative index of the vertex with this key, or -1 with *slot set
+// to where it goes (NULL when the table is full).
+static int dedupFind(const float key[5], DedupEntry **slot) {
+    DedupEntry *e = dedupGrow() ? dedupSlot(key) : NULL;
+    *slot = e;
+    return e && e->gen == gDedupGen ? e->index : -1;
+}
+
+static void dedupInsert(DedupEntry *e, const float key[5], int index) {
+    if (!e) return;
+    e->gen = gDedupGen;
+    e->index = index;
+    memcpy(e->key, key, 5 * sizeof(float));
+    gDedupUsed++;
+}
+
+static int dedupGrow(void) {
+    if (gDedupCap > 0 && gDedupUsed * 2 < gDedupCap) return 1;
+
+    int oldCap = gDedupCap;
+    DedupEntry *old = gDedup;
+    int newCap = oldCap > 0 ? oldCap * 2 : 256;
+    DedupEntry *table = calloc((size_t)newCap, sizeof(DedupEntry));
+    if (!table) return 0;
+
+    gDedup = table;
+    gDedupCap = newCap;
+    for (int i = 0; i < oldCap; i++) {
+        if (old[i].gen != gDedupGen) continue;
+        *dedupSlot(old[i].key) = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+typedef struct FaceSlice FaceSlice;
+
+// slice is set on face worker threads, which write their output there
+// instead of the arena (see "parallel face processing").
+typedef struct {
+    const Mesh *mesh;
+    SDL_Color baseColor;
+    FaceSlice *slice;
+} EmitState;
+
+static void writeVertex(SDL_Vertex *out, const ViewVert *p, const Mesh *mesh, SDL_Color baseColor) {
+    if (gShadeScale > 0.0f) {
+        float shade = gShadeScale / (gShadeBias + p->z);
+        if (shade > 1.0f) shade = 1.0f;
+        if (shade < gShadeMin) shade = gShadeMin;
+        baseColor.r = (Uint8)(baseColor.r * shade);
+        baseColor.g = (Uint8)(baseColor.g * shade);
+        baseColor.b = (Uint8)(baseColor.b * shade);
+    }
+
+    float uWrap = p->u - floorf(p->u);
+    float tWrap = p->t - floorf(p->t);
+    if (uWrap == 0.0f && p->u > 0.0f) uWrap = 1.0f;
+    if (tWrap == 0.0f && p->t > 0.0f) tWrap = 1.0f;
+
+    out->position.x = p->sx;
+    out->position.y = p->sy;
+    out->tex_coord.x = uWrap;
+    out->tex_coord.y = tWrap;
+
+    if (mesh->texture) {
+        out->color.r = baseColor.r;
+        out->color.g = baseColor.g;
+        out->color.b = baseColor.b;
+        out->color.a = baseColor.a;
+    } else {
+        float rScale = 0.5f + uWrap * 0.5f;
+        float gScale = 0.5f + tWrap * 0.5f;
+        float bScale = 0.35f + (1.0f - (uWrap + tWrap) * 0.5f) * 0.35f;
+        out->color.r = (Uint8)fminf(255.0f, baseColor.r * rScale);
+        out->color.g = (Uint8)fminf(255.0f, baseColor.g * gScale);
+        out->color.b = (Uint8)fminf(255.0f, baseColor.b * bScale);
+        out->color.a = baseColor.a;
+    }
+}
+
+// Caller guarantees room for the vertex in the arena and the batch.
+static Render3DIndex emitVertex(const EmitState *es, const ViewVert *p) {
+    float key[5] = {p->x, p->y, p->z, p->u, p->t};
+    DedupEntry *e;
+    int found = dedupFind(key, &e);
+    if (found >= 0) return (Render3DIndex)found;
+
+    int local = gArena.count - gBatch.start;
+    writeVertex(&gArena.verts[gArena.count++], p, es->mesh, es->baseColor);
+    dedupInsert(e, key, local);
+    return (Render3DIndex)local;
+}
+
+// Room for one more triangle of the texture in the current batch. A batch
+// never spans textures or more vertices than the index type can address;
+// flushing also empties the dedup table.
+static int batchReserveTriangle(SDL_Texture *texture) {
+    if (gBatch.texture != texture || gArena.count - gBatch.start + 3 > RENDER3D_MAX_BATCH_VERTS) {
+        if (gArena.count > gBatch.start) render3dFlush();
+        gBatch.texture = texture;
+    }
+    return arenaReserve(gArena.count + 3) && arenaReserveIndices(gArena.indexCount + 3);
+}
+
+static int sliceTriangle(FaceSlice *slice, const EmitState *es, const ViewVert *tri);
+
+static int emitTriangle(EmitState *es, const ViewVert *tri) {
+    if (es->slice) return sliceTriangle(es->slice, es, tri);
+    if (!batchReserveTriangle(es->mesh->texture)) return 0;
+
+    for (int k = 0; k < 3; k++) {
+        gArena.indices[gArena.indexCount++] = emitVertex(es, &tri[k]);
+    }
+    return 1;
+}
+
+// ---- tessellation ----------------------------------------------------------
+//
+// Each edge gets its own level from its own endpoints, so two faces sharing
+// an edge always split it the same way and no T-junctions appear. Mesh edges
+// remember their level across frames in gEdgeCache (keyed by world-space
+// endpoints, so neighbouring meshes share entries) and only change it when
+// the depth ratio leaves the hysteresis band. The topology for each
+// (level0, level1, level2) triple is built once into a TessPattern; per
+// frame only the pattern's points are re-evaluated and projected.
+
+typedef struct {
+    Uint8 edge;     // 0: a-b, 1: b-c, 2: c-a, 3: corner or interior
+    Uint8 step;     // edge points: position along the edge, in 1/n units
+    Uint8 wa, wb, wc;
+} TessPoint;
+
+typedef struct {
+    int n;          // 2^max(level)
+    int pointCount;
+    int triCount;
+    TessPoint *points;
+    Uint16 *tris;
+} TessPattern;
+
+static TessPattern *gTessPatterns[TESS_MAX_LEVEL + 1][TESS_MAX_LEVEL + 1][TESS_MAX_LEVEL + 1];
+
+static TessPattern *buildTessPattern(int l0, int l1, int l2) {
+    int lmax = l0 > l1 ? l0 : l1;
+    if (l2 > lmax) lmax = l2;
+    int n = 1 << lmax;
+    int gridCount = (n + 1) * (n + 2) / 2;
+
+    TessPattern *pat = calloc(1, sizeof(TessPattern));
+    int *remap = malloc((size_t)gridCount * sizeof(int));
+    if (!pat || !remap) { free(pat); free(remap); return NULL; }
+    pat->n = n;
+    pat->points = malloc((size_t)gridCount * sizeof(TessPoint));
+    pat->tris = malloc((size_t)n * n * 3 * sizeof(Uint16));
+    if (!pat->points || !pat->tris) {
+        free(pat->points); free(pat->tris); free(pat); free(remap);
+        return NULL;
+    }
+
+    // Grid point (j, k) has barycentric weights (n-j-k, j, k) over (a, b, c).
+    // Points on a coarser edge snap back to the nearest coarser point toward
+    // the edge's start, which only slides them along the edge.
+    #define GRID_ID(j, k) ((j) * (2 * n + 3 - (j)) / 2 + (k))
+    for (int i = 0; i < gridCount; i++) remap[i] = -1;
+    for (int j = 0; j <= n; j++) {
+        for (int k = 0; k <= n - j; k++) {
+            int sj = j, sk = k;
+            TessPoint pt = {3, 0, 0, 0, 0};
+            if (k == 0 && j > 0 && j < n) {
+                int step = n >> l0;
+                sj = j / step * step;
+                pt = (TessPoint){0, (Uint8)sj, 0, 0, 0};
+            } else if (j + k == n && k > 0 && k < n) {
+                int step = n >> l1;
+                sk = k / step * step;
+                sj = n - sk;
+                pt = (TessPoint){1, (Uint8)sk, 0, 0, 0};
+            } else if (j == 0 && k > 0 && k < n) {
+                int step = n >> l2;
+                sk = n - (n - k) / step * step;
+                pt = (TessPoint){2, (Uint8)(n - sk), 0, 0, 0};
+            }
+            int id = GRID_ID(sj, sk);
+            if (remap[id] < 0) {
+                pt.wa = (Uint8)(n - sj - sk);
+                pt.wb = (Uint8)sj;
+                pt.wc = (Uint8)sk;
+                // Snapped onto a corner: evaluate as the corner itself.
+                if ((pt.edge == 0 && (pt.step == 0 || pt.step == n)) ||
+                    (pt.edge == 1 && (pt.step == 0 || pt.step == n)) ||
+                    (pt.edge == 2 && (pt.step == 0 || pt.step == n))) pt.edge = 3;
+                remap[id] = pat->pointCount;
+                pat->points[pat->pointCount++] = pt;
+            }
+            remap[GRID_ID(j, k)] = remap[id];
+        }
+    }
+
+    for (int j = 0; j < n; j++) {
+        for (int k = 0; k < n - j; k++) {
+            int tri[2][3] = {
+                {remap[GRID_ID(j, k)], remap[GRID_ID(j + 1, k)], remap[GRID_ID(j, k + 1)]},
+                {-1, -1, -1},
+            };
+            if (j + k < n - 1) {
+                tri[1][0] = remap[GRID_ID(j + 1, k)];
+                tri[1][1] = remap[GRID_ID(j + 1, k + 1)];
+                tri[1][2] = remap[GRID_ID(j, k + 1)];
+            }
+            for (int t = 0; t < 2; t++) {
+                int *q = tri[t];
+                if (q[0] < 0 || q[0] == q[1] || q[1] == q[2] || q[2] == q[0]) continue;
+                for (int c = 0; c < 3; c++) pat->tris[pat->triCount * 3 + c] = (Uint16)q[c];
+                pat->triCount++;
+            }
+        }
+    }
+    #undef GRID_ID
+
+    free(remap);
+    return pat;
+}
+
+static const TessPattern *tessPattern(int l0, int l1, int l2) {
+    TessPattern **slot = &gTessPatterns[l0][l1][l2];
+    if (!*slot) *slot = buildTessPattern(l0, l1, l2);
+    return *slot;
+}
+
+// Level needed for an edge with view depths z0, z1. With a cached level,
+// keep it while the edge stays inside the hysteresis band around it.
+static int edgeLevel(float z0, float z1, int cached) {
+    float lo = fmaxf(0.0001f, fminf(z0, z1));
+    float hi = fmaxf(z0, z1);
+    // Splitting into m pieces leaves a worst ratio of 1 + (hi/lo - 1) / m.
+    float need = (hi / lo - 1.0f) / (gMaxDepthRatio - 1.0f);
+
+    if (cached >= 0 && cached <= gMaxSubdiv) {
+        float upper = (float)(1 << cached) * (1.0f + TESS_HYSTERESIS);
+        float lower = cached > 0 ? (float)(1 << (cached - 1)) * (1.0f - TESS_HYSTERESIS) : -1.0f;
+        if ((need <= upper || cached == gMaxSubdiv) && need >= lower) return cached;
+    }
+
+    int level = 0;
+    while (level < gMaxSubdiv && (float)(1 << level) < need) level++;
+    return level;
+}
+
+typedef struct {
+    Uint32 frame;   // 0 marks an empty slot
+    Sint8 level;
+    float key[6];
+} EdgeCacheEntry;
+
+static EdgeCacheEntry *gEdgeCache = NULL;
+static int gEdgeCacheCap = 0;
+static int gEdgeCacheUsed = 0;
+
+// Edges not drawn for this many frames are dropped when the table fills.
+#define EDGE_CACHE_KEEP_FRAMES 8
+
+static EdgeCacheEntry *edgeSlot(const float key[6]);
+
+static int vecLess(const float *a, const float *b) {
+    for (int i = 0; i < 3; i++) {
+        if (a[i] != b[i]) return a[i] < b[i];
+    }
+    return 0;
+}
+
+static void edgeKey(const float pa[3], const float pb[3], float key[6]) {
+    const float *lo = vecLess(pb, pa) ? pb : pa;
+    const float *hi = lo == pa ? pb : pa;
+    memcpy(key, lo, 3 * sizeof(float));
+    memcpy(key + 3, hi, 3 * sizeof(float));
+}
+
+// Entry holding key, or the empty slot it would go into.
+static EdgeCacheEntry *edgeSlot(const float key[6]) {
+    Uint32 h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        Uint32 bits;
+        memcpy(&bits, &key[i], sizeof(bits));
+        h = (h ^ bits) * 16777619u;
+        h ^= h >> 15;
+    }
+
+    Uint32 mask = (Uint32)gEdgeCacheCap - 1;
+    for (Uint32 i = h & mask;; i = (i + 1) & mask) {
+        EdgeCacheEntry *e = &gEdgeCache[i];
+        if (e->frame == 0 || memcmp(e->key, key, 6 * sizeof(float)) == 0) return e;
+    }
+}
+
+// Makes room for extra more entries under the half-full load limit. The
+// edges drawn in the last EDGE_CACHE_KEEP_FRAMES frames are rehashed into a
+// fresh table and the rest dropped, so the table follows what is on screen
+// rather than everything ever drawn. It only doubles while those recent
+// edges would take more than half the room below the limit, so the next
+// rehash is not due again a few meshes later.
+static int edgeCacheReserve(int extra) {
+    if (gEdgeCacheCap > 0 && (long long)(gEdgeCacheUsed + extra) * 2 < gEdgeCacheCap) return 1;
+
+    int live = 0;
+    for (int i = 0; i < gEdgeCacheCap; i++) {
+        Uint32 frame = gEdgeCache[i].frame;
+        if (frame != 0 && gFrameIndex - frame < EDGE_CACHE_KEEP_FRAMES) live++;
+    }
+    long long newCap = gEdgeCacheCap > 0 ? gEdgeCacheCap : 4096;
+    while ((long long)(live * 2 + extra) * 2 >= newCap) newCap *= 2;
+    if (newCap > 0x40000000) return 0;
+    EdgeCacheEntry *table = calloc((size_t)newCap, sizeof(EdgeCacheEntry));
+    if (!table) return 0;
+
+    EdgeCacheEntry *old = gEdgeCache;
+    int oldCap = gEdgeCacheCap;
+    gEdgeCache = table;
+    gEdgeCacheCap = (int)newCap;
+    gEdgeCacheUsed = 0;
+    for (int i = 0; i < oldCap; i++) {
+        const EdgeCacheEntry *e = &old[i];
+        if (e->frame == 0 || gFrameIndex - e->frame >= EDGE_CACHE_KEEP_FRAMES) continue;
+        *edgeSlot(e->key) = *e;
+        gEdgeCacheUsed++;
+    }
+    free(old);
+    return 1;
+}
+
+static void edgeStore(EdgeCacheEntry *e, const float key[6], int level) {
+    if (e->frame == 0) {
+        memcpy(e->key, key, 6 * sizeof(float));
+        gEdgeCacheUsed++;
+    }
+    e->frame = gFrameIndex;
+    e->level = (Sint8)level;
+}
+
+// Level for an entry not yet visited this frame.
+static int staleEdgeLevel(const EdgeCacheEntry *e, float za, float zb) {
+    return edgeLevel(za, zb, e->frame != 0 ? e->level : -1);
+}
+
+static int cachedEdgeLevel(const float pa[3], const float pb[3], float za, float zb) {
+    if (!edgeCacheReserve(1)) return edgeLevel(za, zb, -1);
+
+    float key[6];
+    edgeKey(pa, pb, key);
+    EdgeCacheEntry *e = edgeSlot(key);
+    if (e->frame == gFrameIndex) return e->level;
+    int level = staleEdgeLevel(e, za, zb);
+    edgeStore(e, key, level);
+    return level;
+}
+
+static int viewVertLess(const ViewVert *a, const ViewVert *b) {
+    const float ka[5] = {a->x, a->y, a->z, a->u, a->t};
+    const float kb[5] = {b->x, b->y, b->z, b->u, b->t};
+    for (int i = 0; i < 5; i++) {
+        if (ka[i] != kb[i]) return ka[i] < kb[i];
+    }
+    return 0;
+}
+
+// Point at step/n along p->q, always interpolated from the smaller endpoint
+// so both faces sharing the edge produce the same bits.
+static ViewVert edgePoint(const ViewVert *p, const ViewVert *q, int step, int n, const Render3DView *vw) {
+    float t = (float)step / (float)n;
+    if (viewVertLess(q, p)) {
+        const ViewVert *tmp = p;
+        p = q;
+        q = tmp;
+        t = 1.0f - t;
+    }
+    ViewVert r;
+    r.x = p->x + (q->x - p->x) * t;
+    r.y = p->y + (q->y - p->y) * t;
+    r.z = p->z + (q->z - p->z) * t;
+    r.u = p->u + (q->u - p->u) * t;
+    r.t = p->t + (q->t - p->t) * t;
+    r.src = -1;
+    projectVert(&r, vw);
+    return r;
+}
+
+typedef struct {
+    const Mat34 *world;  // NULL when the mesh is already in world space
+} TessContext;
+
+static void streamWorldPos(const TessContext *tc, int src, float out[3]) {
+    Vec3 p = v3(gStream.x[src], gStream.y[src], gStream.z[src]);
+    if (tc->world) p = render3dMat34Apply(tc->world, p);
+    out[0] = p.x;
+    out[1] = p.y;
+    out[2] = p.z;
+}
+
+static int sliceEdgeLevel(FaceSlice *slice, const float pa[3], const float pb[3], float za, float zb);
+
+static int triangleEdgeLevel(const EmitState *es, const TessContext *tc, const ViewVert *a, const ViewVert *b) {
+    if (gMaxSubdiv <= 0) return 0;
+    if (a->src < 0 || b->src < 0) return edgeLevel(a->z, b->z, -1);
+    float pa[3], pb[3];
+    streamWorldPos(tc, a->src, pa);
+    streamWorldPos(tc, b->src, pb);
+    if (es->slice) return sliceEdgeLevel(es->slice, pa, pb, a->z, b->z);
+    return cachedEdgeLevel(pa, pb, a->z, b->z);
+}
+
+static int tessellateTriangle(EmitState *es, const TessContext *tc, const ViewVert *a, const ViewVert *b, const ViewVert *c, const Render3DView *vw) {
+    int l0 = triangleEdgeLevel(es, tc, a, b);
+    int l1 = triangleEdgeLevel(es, tc, b, c);
+    int l2 = triangleEdgeLevel(es, tc, c, a);
+
+    if ((l0 | l1 | l2) == 0) {
+        ViewVert tri[3] = {*a, *b, *c};
+        return emitTriangle(es, tri);
+    }
+
+    const TessPattern *pat = tessPattern(l0, l1, l2);
+    if (!pat) return 0;
+
+    ViewVert pts[(1 << TESS_MAX_LEVEL) + 1][(1 << TESS_MAX_LEVEL) + 2];
+    ViewVert *flat = &pts[0][0];
+    float inv = 1.0f / (float)pat->n;
+    for (int i = 0; i < pat->pointCount; i++) {
+        const TessPoint *pt = &pat->points[i];
+        ViewVert *r = &flat[i];
+        if (pt->edge == 0) { *r = edgePoint(a, b, pt->step, pat->n, vw); continue; }
+        if (pt->edge == 1) { *r = edgePoint(b, c, pt->step, pat->n, vw); continue; }
+        if (pt->edge == 2) { *r = edgePoint(c, a, pt->step, pat->n, vw); continue; }
+        if (pt->wa == pat->n) { *r = *a; continue; }
+        if (pt->wb == pat->n) { *r = *b; continue; }
+        if (pt->wc == pat->n) { *r = *c; continue; }
+
+        float wa = pt->wa * inv, wb = pt->wb * inv, wc = pt->wc * inv;
+        r->x = a->x * wa + b->x * wb + c->x * wc;
+        r->y = a->y * wa + b->y * wb + c->y * wc;
+        r->z = a->z * wa + b->z * wb + c->z * wc;
+        r->u = a->u * wa + b->u * wb + c->u * wc;
+        r->t = a->t * wa + b->t * wb + c->t * wc;
+        r->src = -1;
+        projectVert(r, vw);
+    }
+
+    for (int t = 0; t < pat->triCount; t++) {
+        const Uint16 *q = &pat->tris[t * 3];
+        ViewVert tri[3] = {flat[q[0]], flat[q[1]], flat[q[2]]};
+        if (!emitTriangle(es, tri)) return 0;
+    }
+    return 1;
+}
+
+// Software backend: the rasterizer interpolates perspective-correctly, so
+// clipped polygons go straight to it without tessellation.
+static int slicePolygon(FaceSlice *slice, const Raster3DVertex *rv, int count);
+
+static int rasterPolygon(const EmitState *es, const ViewVert *poly, int count) {
+    Raster3DVertex rv[12];
+    for (int i = 0; i < count; i++) {
+        SDL_Vertex sv;
+        writeVertex(&sv, &poly[i], es->mesh, es->baseColor);
+        rv[i] = (Raster3DVertex){poly[i].sx, poly[i].sy, poly[i].z, poly[i].u, poly[i].t, sv.color};
+    }
+    if (es->slice) return slicePolygon(es->slice, rv, count);
+    for (int i = 1; i < count - 1; i++) {
+        raster3dTriangle(&rv[0], &rv[i], &rv[i + 1], es->mesh->texture);
+    }
+    return 1;
+}
+
+void render3dSetSubdivision(int maxLevel, float maxDepthRatio) {
+    if (maxLevel < 0) maxLevel = 0;
+    if (maxLevel > TESS_MAX_LEVEL) maxLevel = TESS_MAX_LEVEL;
+    gMaxSubdiv = maxLevel;
+    gMaxDepthRatio = maxDepthRatio > 1.01f ? maxDepthRatio : 1.01f;
+}
+
+// Clips, culls, tessellates and emits faces [first, last) of the mesh in
+// gStream, in index order. Returns 0 where the mesh has to stop early.
+static int processFaces(EmitState *es, const TessContext *tc, int first, int last, int *backfaces) {
+    const Mesh *mesh = es->mesh;
+    const Render3DView *vw = render3dGetView();
+    for (int i = first * 3; i < last * 3; i += 3) {
         ViewVert in[3];
         int inCount = 0;
+        Uint8 codeAnd = 0xFF, codeOr = 0;
 
         for (int j = 0; j < 3; j++) {
             int idx = mesh->indices ? mesh->indices[i + j] : (i + j);
             if (idx < 0 || idx >= mesh->vertCount) { continue; }
 
-            Vec3 world = rotateVector(mesh->verts[idx], rotation);
-            world = v3_add(world, position);
-
-            float u = (mesh->uvs && idx < mesh->vertCount) ? mesh->uvs[idx].x : 0.0f;
-            float t = (mesh->uvs && idx < mesh->vertCount) ? mesh->uvs[idx].y : 0.0f;
-            Vec3 rel = v3_sub(world, gCamera.position);
-            in[inCount].x = v3_dot(rel, right);
-            in[inCount].y = v3_dot(rel, upVec);
-            in[inCount].z = v3_dot(rel, forward);
-            in[inCount].u = u;
-            in[inCount].t = t;
+            in[inCount].x = gStream.cx[idx];
+            in[inCount].y = gStream.cy[idx];
+            in[inCount].z = gStream.cw[idx];
+            in[inCount].u = mesh->uvs ? mesh->uvs[idx].x : 0.0f;
+            in[inCount].t = mesh->uvs ? mesh->uvs[idx].y : 0.0f;
+            in[inCount].sx = gStream.sx[idx];
+            in[inCount].sy = gStream.sy[idx];
+            in[inCount].src = idx;
+            codeAnd &= gStream.outcode[idx];
+            codeOr |= gStream.outcode[idx];
             inCount++;
         }
 
-        if (inCount < 3) continue;
-
-        ViewVert clipped[6];
-        int clipCount = 0;
-
-        for (int j = 0; j < inCount; j++) {
-            ViewVert cur = in[j];
-            ViewVert prev = in[(j + inCount - 1) % inCount];
-            int curInside = cur.z >= NEAR_PLANE;
-            int prevInside = prev.z >= NEAR_PLANE;
-
-            if (curInside != prevInside) {
-                float t = (NEAR_PLANE - prev.z) / (cur.z - prev.z);
-                ViewVert inter;
-                inter.x = prev.x + (cur.x - prev.x) * t;
-                inter.y = prev.y + (cur.y - prev.y) * t;
-                inter.z = NEAR_PLANE;
-                inter.u = prev.u + (cur.u - prev.u) * t;
-                inter.t = prev.t + (cur.t - prev.t) * t;
-                if (clipCount < (int)(sizeof(clipped) / sizeof(clipped[0]))) clipped[clipCount++] = inter;
-            }
+        // All three corners outside the same plane: nothing can be visible.
+        // (GUARD is a union of four planes, so it can't reject on its own.)
+        if (inCount < 3 || (codeAnd & ~XFORM3D_OUT_GUARD) != 0) continue;
 
-            if (curInside) {
-                if (clipCount < (int)(sizeof(clipped) / sizeof(clipped[0]))) clipped[clipCount++] = cur;
+        ViewVert clipped[12];
+        int clipCount = clipNear(in, inCount, clipped, 12, vw);
+        if (mesh->cullMode != RENDER3D_CULL_NONE && clipCount >= 3) {
+            float area = polygonArea(clipped, clipCount);
+            if (mesh->cullMode == RENDER3D_CULL_BACK ? area <= 0.0f : area >= 0.0f) {
+                (*backfaces)++;
+                continue;
             }
         }
-
+        if (gClipMode == RENDER3D_CLIP_FULL && (codeOr & (XFORM3D_OUT_FAR | XFORM3D_OUT_GUARD))) {
+            clipCount = clipFrustum(clipped, clipCount, 12, vw);
+        }
         if (clipCount < 3) continue;
 
+        if (gFrameBackend == RENDER3D_BACKEND_SOFTWARE) {
+            if (!rasterPolygon(es, clipped, clipCount)) return 0;
+            continue;
+        }
         for (int j = 1; j < clipCount - 1; j++) {
-            typedef struct { ViewVert tri[3]; int depth; } TriWork;
-            TriWork stack[64];
-            int stackCount = 0;
-            stack[stackCount++] = (TriWork){{clipped[0], clipped[j], clipped[j + 1]}, 0};
-
-            const int MAX_SUBDIV = 3;
-            const float MAX_DEPTH_RATIO = 1.35f;
-
-            while (stackCount > 0) {
-                TriWork work = stack[--stackCount];
-                ViewVert *tri = work.tri;
-
-                float minZ = fminf(tri[0].z, fminf(tri[1].z, tri[2].z));
-                float maxZ = fmaxf(tri[0].z, fmaxf(tri[1].z, tri[2].z));
-                int shouldSubdivide = (work.depth < MAX_SUBDIV) && (maxZ / fmaxf(0.0001f, minZ) > MAX_DEPTH_RATIO);
-
-                if (shouldSubdivide) {
-                    ViewVert ab, bc, ca;
-                    ab.x = 0.5f * (tri[0].x + tri[1].x);
-                    ab.y = 0.5f * (tri[0].y + tri[1].y);
-                    ab.z = 0.5f * (tri[0].z + tri[1].z);
-                    ab.u = 0.5f * (tri[0].u + tri[1].u);
-                    ab.t = 0.5f * (tri[0].t + tri[1].t);
-
-                    bc.x = 0.5f * (tri[1].x + tri[2].x);
-                    bc.y = 0.5f * (tri[1].y + tri[2].y);
-                    bc.z = 0.5f * (tri[1].z + tri[2].z);
-                    bc.u = 0.5f * (tri[1].u + tri[2].u);
-                    bc.t = 0.5f * (tri[1].t + tri[2].t);
-
-                    ca.x = 0.5f * (tri[2].x + tri[0].x);
-                    ca.y = 0.5f * (tri[2].y + tri[0].y);
-                    ca.z = 0.5f * (tri[2].z + tri[0].z);
-                    ca.u = 0.5f * (tri[2].u + tri[0].u);
-                    ca.t = 0.5f * (tri[2].t + tri[0].t);
-
-                    TriWork children[4] = {
-                        {{tri[0], ab, ca}, work.depth + 1},
-                        {{ab, tri[1], bc}, work.depth + 1},
-                        {{ca, bc, tri[2]}, work.depth + 1},
-                        {{ab, bc, ca}, work.depth + 1},
-                    };
-
-                    for (int c = 0; c < 4 && stackCount < (int)(sizeof(stack) / sizeof(stack[0])); c++) {
-                        stack[stackCount++] = children[c];
-                    }
-                    continue;
-                }
+            if (!tessellateTriangle(es, tc, &clipped[0], &clipped[j], &clipped[j + 1], vw)) return 0;
+        }
+    }
+    return 1;
+}
 
-                for (int k = 0; k < 3; k++) {
-                    if (v + 3 > vertTotal) {
-                        int newTotal = vertTotal * 2;
-                        while (v + 3 > newTotal) newTotal *= 2;
-
-                        SDL_Vertex *grown = realloc(verts, (size_t)newTotal * sizeof(SDL_Vertex));
-                        if (!grown) {
-                            free(verts);
-                            return;
-                        }
-
-                        verts = grown;
-                        vertTotal = newTotal;
-                    }
+// ---- parallel face processing ----------------------------------------------
+//
+// Meshes with enough faces are split into one contiguous slice of faces per
+// thread. Workers run processFaces into their slice: finished vertices with
+// their dedup keys (or raster triangles for the software backend), and the
+// edge cache entries they would have written. The edge cache is only read
+// while they run; within one mesh an edge's level depends only on its
+// endpoints and last frame's entry, so it comes out the same whichever face
+// gets there first. The calling thread then writes the entries and merges
+// the slices in face order through the same dedup and batching as the
+// single-threaded path, so the output is identical and only it touches
+// SDL.
+
+#define FACE_MAX_THREADS 16
+// Meshes below this many faces per thread stay on the calling thread.
+#define FACE_MIN_SLICE 64
+
+struct FaceSlice {
+    SDL_Vertex *verts;        // SDL backend: three per output triangle
+    float (*keys)[5];         // dedup key of each vertex
+    Raster3DVertex *rverts;   // software backend: three per triangle
+    int count;
+    int capacity, rcapacity;
+    EdgeCacheEntry *edges;    // edge cache writes, in order
+    int edgeCount, edgeCapacity;
+    int backfaces;
+    int stopped;              // processFaces ended early
+    int failed;               // out of memory: redo the mesh serially
+};
+
+static FaceSlice gSlices[FACE_MAX_THREADS];
+static SDL_Thread *gFaceWorkers[FACE_MAX_THREADS];
+static int gFaceWorkerCount = 0;
+static int gFaceWorkersStarted = 0;
+static SDL_sem *gFaceStartSem = NULL;
+static SDL_sem *gFaceDoneSem = NULL;
+static SDL_atomic_t gNextSlice;
+static volatile int gFaceQuit = 0;
+
+// The job the workers pick slices of.
+static struct {
+    const Mesh *mesh;
+    const Mat34 *world;
+    SDL_Color baseColor;
+    int faceCount;
+    int sliceCount;
+} gFaceJob;
+
+static int growCapacity(int capacity, int count) {
+    int newCap = capacity > 0 ? capacity : 1024;
+    while (count > newCap) newCap *= 2;
+    return newCap;
+}
+
+static int sliceReserve(FaceSlice *slice, int count) {
+    count += slice->count;
+    if (gFrameBackend == RENDER3D_BACKEND_SOFTWARE) {
+        if (count <= slice->rcapacity) return 1;
+        int newCap = growCapacity(slice->rcapacity, count);
+        Raster3DVertex *rverts = realloc(slice->rverts, (size_t)newCap * sizeof(Raster3DVertex));
+        if (!rverts) return 0;
+        slice->rverts = rverts;
+        slice->rcapacity = newCap;
+        return 1;
+    }
+
+    if (count <= slice->capacity) return 1;
+    int newCap = growCapacity(slice->capacity, count);
+    SDL_Vertex *verts = realloc(slice->verts, (size_t)newCap * sizeof(SDL_Vertex));
+    if (verts) slice->verts = verts;
+    float (*keys)[5] = realloc(slice->keys, (size_t)newCap * sizeof(*keys));
+    if (keys) slice->keys = keys;
+    if (!verts || !keys) return 0;
+    slice->capacity = newCap;
+    return 1;
+}
+
+static int sliceTriangle(FaceSlice *slice, const EmitState *es, const ViewVert *tri) {
+    if (!sliceReserve(slice, 3)) { slice->failed = 1; return 0; }
+    for (int k = 0; k < 3; k++) {
+        const ViewVert *p = &tri[k];
+        float *key = slice->keys[slice->count];
+        key[0] = p->x; key[1] = p->y; key[2] = p->z; key[3] = p->u; key[4] = p->t;
+        writeVertex(&slice->verts[slice->count], p, es->mesh, es->baseColor);
+        slice->count++;
+    }
+    return 1;
+}
+
+static int slicePolygon(FaceSlice *slice, const Raster3DVertex *rv, int count) {
+    if (!sliceReserve(slice, (count - 2) * 3)) { slice->failed = 1; return 0; }
+    for (int i = 1; i < count - 1; i++) {
+        slice->rverts[slice->count++] = rv[0];
+        slice->rverts[slice->count++] = rv[i];
+        slice->rverts[slice->count++] = rv[i + 1];
+    }
+    return 1;
+}
+
+static int sliceEdgeLevel(FaceSlice *slice, const float pa[3], const float pb[3], float za, float zb) {
+    float key[6];
+    edgeKey(pa, pb, key);
+    const EdgeCacheEntry *e = edgeSlot(key);
+    if (e->frame == gFrameIndex) return e->level;
+    int level = staleEdgeLevel(e, za, zb);
+
+    if (slice->edgeCount == slice->edgeCapacity) {
+        int newCap = slice->edgeCapacity > 0 ? slice->edgeCapacity * 2 : 256;
+        EdgeCacheEntry *grown = realloc(slice->edges, (size_t)newCap * sizeof(EdgeCacheEntry));
+        // Losing the write would change later frames; redo serially.
+        if (!grown) { slice->failed = 1; return level; }
+        slice->edges = grown;
+        slice->edgeCapacity = newCap;
+    }
+    EdgeCacheEntry *w = &slice->edges[slice->edgeCount++];
+    memcpy(w->key, key, sizeof(key));
+    w->level = (Sint8)level;
+    return level;
+}
+
+static void runSlice(int s) {
+    FaceSlice *slice = &gSlices[s];
+    slice->count = 0;
+    slice->edgeCount = 0;
+    slice->backfaces = 0;
+    slice->failed = 0;
+
+    int first = (int)((long long)gFaceJob.faceCount * s / gFaceJob.sliceCount);
+    int last = (int)((long long)gFaceJob.faceCount * (s + 1) / gFaceJob.sliceCount);
+    EmitState es = {gFaceJob.mesh, gFaceJob.baseColor, slice};
+    TessContext tc = {gFaceJob.world};
+    slice->stopped = !processFaces(&es, &tc, first, last, &slice->backfaces);
+}
+
+static void runSlices(void) {
+    int s;
+    while ((s = SDL_AtomicAdd(&gNextSlice, 1)) < gFaceJob.sliceCount) runSlice(s);
+}
+
+static int faceWorkerMain(void *data) {
+    (void)data;
+    for (;;) {
+        SDL_SemWait(gFaceStartSem);
+        if (gFaceQuit) break;
+        runSlices();
+        SDL_SemPost(gFaceDoneSem);
+    }
+    return 0;
+}
+
+static int wantedFaceThreads(void) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 1;
+#else
+    int count = SDL_GetCPUCount();
+    if (count < 1) count = 1;
+    if (count > FACE_MAX_THREADS) count = FACE_MAX_THREADS;
+    return count;
+#endif
+}
+
+static void stopFaceWorkers(void) {
+    gFaceQuit = 1;
+    for (int i = 0; i < gFaceWorkerCount; i++) SDL_SemPost(gFaceStartSem);
+    for (int i = 0; i < gFaceWorkerCount; i++) SDL_WaitThread(gFaceWorkers[i], NULL);
+    if (gFaceStartSem) SDL_DestroySemaphore(gFaceStartSem);
+    if (gFaceDoneSem) SDL_DestroySemaphore(gFaceDoneSem);
+    gFaceStartSem = gFaceDoneSem = NULL;
+    gFaceWorkerCount = 0;
+    gFaceWorkersStarted = 0;
+    gFaceQuit = 0;
+}
 
-                    float uWrap = tri[k].u - floorf(tri[k].u);
-                    float tWrap = tri[k].t - floorf(tri[k].t);
-                    if (uWrap == 0.0f && tri[k].u > 0.0f) uWrap = 1.0f;
-                    if (tWrap == 0.0f && tri[k].t > 0.0f) tWrap = 1.0f;
-
-                    float nx = (tri[k].x * f / aspect) / tri[k].z;
-                    float ny = (tri[k].y * f) / tri[k].z;
-
-                    verts[v].position.x = (nx * 0.5f + 0.5f) * WINW;
-                    verts[v].position.y = (1.0f - (ny * 0.5f + 0.5f)) * WINH;
-                    verts[v].tex_coord.x = uWrap;
-                    verts[v].tex_coord.y = tWrap;
-
-                    if (mesh->texture) {
-                        verts[v].color.r = baseColor.r;
-                        verts[v].color.g = baseColor.g;
-                        verts[v].color.b = baseColor.b;
-                        verts[v].color.a = baseColor.a;
-                    } else {
-                        float rScale = 0.5f + uWrap * 0.5f;
-                        float gScale = 0.5f + tWrap * 0.5f;
-                        float bScale = 0.35f + (1.0f - (uWrap + tWrap) * 0.5f) * 0.35f;
-                        verts[v].color.r = (Uint8)fminf(255.0f, baseColor.r * rScale);
-                        verts[v].color.g = (Uint8)fminf(255.0f, baseColor.g * gScale);
-                        verts[v].color.b = (Uint8)fminf(255.0f, baseColor.b * bScale);
-                        verts[v].color.a = baseColor.a;
+// Falls back to fewer (or no) helpers when threads can't be created.
+static void startFaceWorkers(void) {
+    gFaceWorkersStarted = 1;
+    int helpers = wantedFaceThreads() - 1;
+    if (helpers <= 0) return;
+
+    gFaceStartSem = SDL_CreateSemaphore(0);
+    gFaceDoneSem = SDL_CreateSemaphore(0);
+    if (!gFaceStartSem || !gFaceDoneSem) {
+        stopFaceWorkers();
+        gFaceWorkersStarted = 1;
+        return;
+    }
+    while (gFaceWorkerCount < helpers) {
+        SDL_Thread *thread = SDL_CreateThread(faceWorkerMain, "render3d", NULL);
+        if (!thread) break;
+        gFaceWorkers[gFaceWorkerCount++] = thread;
+    }
+}
+
+void render3dShutdown(void) {
+    stopFaceWorkers();
+    raster3dShutdown();
+}
+
+// Tessellation patterns are built lazily; build every one workers could
+// ask for up front so they only read the table.
+static int buildTessPatterns(void) {
+    static int built = -1;
+    if (built >= gMaxSubdiv) return 1;
+    for (int l0 = 0; l0 <= gMaxSubdiv; l0++) {
+        for (int l1 = 0; l1 <= gMaxSubdiv; l1++) {
+            for (int l2 = 0; l2 <= gMaxSubdiv; l2++) {
+                if (!tessPattern(l0, l1, l2)) return 0;
+            }
+        }
+    }
+    built = gMaxSubdiv;
+    return 1;
+}
+
+// Runs the mesh's faces on the worker threads and merges them. Returns 0
+// when the mesh should go through the single-threaded path instead.
+static int submitParallel(const Mesh *mesh, const Mat34 *worldMat, SDL_Color baseColor) {
+    int faceCount = mesh->indexCount / 3;
+    if (!gFaceWorkersStarted) startFaceWorkers();
+    int sliceCount = gFaceWorkerCount + 1;
+    if (sliceCount > faceCount / FACE_MIN_SLICE) sliceCount = faceCount / FACE_MIN_SLICE;
+    if (sliceCount < 2) return 0;
+
+    // The workers look edges up in the table and their new entries are
+    // written afterwards, so it must not be rehashed in between: make room
+    // first, for at most three new edges per face.
+    if (gFrameBackend == RENDER3D_BACKEND_SDL && gMaxSubdiv > 0) {
+        if (!edgeCacheReserve(faceCount * 3)) return 0;
+        if (!buildTessPatterns()) return 0;
+    }
+
+    gFaceJob.mesh = mesh;
+    gFaceJob.world = worldMat;
+    gFaceJob.baseColor = baseColor;
+    gFaceJob.faceCount = faceCount;
+    gFaceJob.sliceCount = sliceCount;
+    SDL_AtomicSet(&gNextSlice, 0);
+    for (int i = 0; i < gFaceWorkerCount; i++) SDL_SemPost(gFaceStartSem);
+    runSlices();
+    for (int i = 0; i < gFaceWorkerCount; i++) SDL_SemWait(gFaceDoneSem);
+
+    for (int s = 0; s < sliceCount; s++) {
+        if (gSlices[s].failed) return 0;
+    }
+
+    for (int s = 0; s < sliceCount; s++) {
+        const FaceSlice *slice = &gSlices[s];
+        gCullStats.backfaces += slice->backfaces;
+        for (int i = 0; i < slice->edgeCount; i++) {
+            const EdgeCacheEntry *w = &slice->edges[i];
+            edgeStore(edgeSlot(w->key), w->key, w->level);
+        }
+        if (slice->stopped) break;
+    }
+
+    for (int s = 0; s < sliceCount; s++) {
+        const FaceSlice *slice = &gSlices[s];
+        if (gFrameBackend == RENDER3D_BACKEND_SOFTWARE) {
+            for (int i = 0; i < slice->count; i += 3) {
+                raster3dTriangle(&slice->rverts[i], &slice->rverts[i + 1], &slice->rverts[i + 2], mesh->texture);
+            }
+        } else {
+            for (int i = 0; i < slice->count; i += 3) {
+                if (!batchReserveTriangle(mesh->texture)) return 1;
+                for (int k = 0; k < 3; k++) {
+                    DedupEntry *e;
+                    int index = dedupFind(slice->keys[i + k], &e);
+                    if (index < 0) {
+                        index = gArena.count - gBatch.start;
+                        gArena.verts[gArena.count++] = slice->verts[i + k];
+                        dedupInsert(e, slice->keys[i + k], index);
                     }
-                    v++;
+                    gArena.indices[gArena.indexCount++] = (Render3DIndex)index;
                 }
             }
         }
+        if (slice->stopped) break;
     }
+    return 1;
+}
 
-    if (v > 0) {
-        SDL_RenderGeometry(renderer, mesh->texture, verts, v, NULL, 0);
+static void submitMesh(const Mesh *mesh, const Mat34 *worldMat, SDL_Color baseColor) {
+    if (!gBatch.active || !mesh || !mesh->verts || mesh->indexCount % 3 != 0) return;
+
+    const Render3DView *vw = render3dGetView();
+    Mat34 mvp = drawTransform(worldMat);
+    Xform3dViewport vp = {vw->nearPlane, vw->farPlane, vw->guardBand, vw->width, vw->height};
+
+    // Whole mesh through the SoA kernel once; triangles then gather by index.
+    xform3dStreamLoad(&gStream, mesh->verts, mesh->vertCount);
+    if (gStream.count != mesh->vertCount) return;
+    xform3dTransform(&gStream, &mvp, &vp);
+
+    dedupReset();
+    if (mesh->indexCount / 3 >= FACE_MIN_SLICE * 2 && submitParallel(mesh, worldMat, baseColor)) return;
+
+    EmitState es = {mesh, baseColor, NULL};
+    TessContext tc = {worldMat};
+    processFaces(&es, &tc, 0, mesh->indexCount / 3, &gCullStats.backfaces);
+}
+
+void render3dSubmitMesh(const Mesh *mesh, Vec3 position, Vec3 rotation, SDL_Color baseColor) {
+    Mat34 scratch;
+    submitMesh(mesh, callTransform(&scratch, position, rotation), baseColor);
+}
+
+static void drawWorldMesh(SDL_Renderer *renderer, const Mesh *mesh, const Mat34 *world, SDL_Color baseColor) {
+    if (!renderer) return;
+
+    // Outside a frame, behave like an immediate draw: one submission per call.
+    if (!gBatch.active) {
+        render3dBeginFrame(renderer);
+        submitMesh(mesh, world, baseColor);
+        if (gFrameBackend == RENDER3D_BACKEND_SOFTWARE) raster3dEndFrame(renderer);
+        else render3dFlush();
+        gBatch.active = 0;
+        return;
+    }
+
+    if (gBatch.renderer != renderer) {
+        render3dFlush();
+        gBatch.renderer = renderer;
     }
+    submitMesh(mesh, world, baseColor);
+}
+
+void drawMesh(SDL_Renderer *renderer, const Mesh *mesh, Vec3 position, Vec3 rotation, SDL_Color baseColor) {
+    Mat34 scratch;
+    drawWorldMesh(renderer, mesh, callTransform(&scratch, position, rotation), baseColor);
+}
 
-    free(verts);
+void drawMeshInstance(SDL_Renderer *renderer, MeshInstance *inst, SDL_Color baseColor) {
+    if (!inst) return;
+    drawWorldMesh(renderer, &inst->mesh, render3dInstanceWorld(inst), baseColor);
 }
 
 void render3dInitQuadMeshUV(MeshInstance *inst, Vec3 v0, Vec3 v1, Vec3 v2, Vec3 v3p, SDL_Color color, SDL_FPoint uv0, SDL_FPoint uv1, SDL_FPoint uv2, SDL_FPoint uv3) {
@@ -255,9 +1514,18 @@ void render3dInitQuadMeshUV(MeshInstance *inst, Vec3 v0, Vec3 v1, Vec3 v2, Vec3
     inst->mesh.indices = inst->indices;
     inst->mesh.indexCount = 6;
     inst->mesh.texture = NULL;
+    inst->mesh.cullMode = RENDER3D_CULL_NONE;
     inst->color = color;
-    inst->position = v3(0.0f, 0.0f, 0.0f);
-    inst->rotation = v3(0.0f, 0.0f, 0.0f);
+    inst->worldValid = 0;
+    render3dSetInstanceTransform(inst, v3(0.0f, 0.0f, 0.0f), v3(0.0f, 0.0f, 0.0f));
+}
+
+void render3dInitMeshInstance(MeshInstance *inst, Mesh mesh, SDL_Color color) {
+    if (!inst) return;
+    inst->mesh = mesh;
+    inst->color = color;
+    inst->worldValid = 0;
+    render3dSetInstanceTransform(inst, v3(0.0f, 0.0f, 0.0f), v3(0.0f, 0.0f, 0.0f));
 }
 
 void render3dInitQuadMesh(MeshInstance *inst, Vec3 v0, Vec3 v1, Vec3 v2, Vec3 v3, SDL_Color color) {
@@ -272,3 +1540,146 @@ int render3dCompareFaceDepth(const void *a, const void *b) {
     if (da > db) return -1;
     return 0;
 }
+
+// Insertion moves allowed per item before the order counts as unsorted.
+static const int DEPTH_SORT_INSERTION_BUDGET = 8;
+
+void render3dDepthSortBegin(Render3DDepthSort *s) {
+    if (!s) return;
+    s->count = 0;
+    if (++s->gen == 0) {
+        // Stamps wrapped: forget them rather than match stale ones.
+        if (s->added) memset(s->added, 0, (size_t)s->indexCapacity * sizeof(Uint32));
+        if (s->placed) memset(s->placed, 0, (size_t)s->indexCapacity * sizeof(Uint32));
+        s->gen = 1;
+    }
+}
+
+static int depthSortGrowIndex(Render3DDepthSort *s, int index) {
+    if (index < s->indexCapacity) return 1;
+    int newCap = s->indexCapacity > 0 ? s->indexCapacity : 1024;
+    while (newCap <= index) newCap *= 2;
+    Uint32 *added = realloc(s->added, (size_t)newCap * sizeof(Uint32));
+    if (added) s->added = added;
+    Uint32 *placed = realloc(s->placed, (size_t)newCap * sizeof(Uint32));
+    if (placed) s->placed = placed;
+    float *depthOf = realloc(s->depthOf, (size_t)newCap * sizeof(float));
+    if (depthOf) s->depthOf = depthOf;
+    if (!added || !placed || !depthOf) return 0;
+    memset(s->added + s->indexCapacity, 0, (size_t)(newCap - s->indexCapacity) * sizeof(Uint32));
+    memset(s->placed + s->indexCapacity, 0, (size_t)(newCap - s->indexCapacity) * sizeof(Uint32));
+    s->indexCapacity = newCap;
+    return 1;
+}
+
+static int depthSortGrowItems(Render3DDepthSort *s, int count) {
+    if (count <= s->capacity) return 1;
+    int newCap = s->capacity > 0 ? s->capacity : 1024;
+    while (newCap < count) newCap *= 2;
+    FaceDepth *items = realloc(s->items, (size_t)newCap * sizeof(FaceDepth));
+    if (items) s->items = items;
+    FaceDepth *scratch = realloc(s->scratch, (size_t)newCap * sizeof(FaceDepth));
+    if (scratch) s->scratch = scratch;
+    int *last = realloc(s->last, (size_t)newCap * sizeof(int));
+    if (last) s->last = last;
+    if (!items || !scratch || !last) return 0;
+    s->capacity = newCap;
+    return 1;
+}
+
+void render3dDepthSortAdd(Render3DDepthSort *s, int index, float depth) {
+    if (!s || index < 0) return;
+    if (!depthSortGrowItems(s, s->count + 1) || !depthSortGrowIndex(s, index)) return;
+    s->items[s->count++] = (FaceDepth){index, depth};
+    s->added[index] = s->gen;
+    s->depthOf[index] = depth;
+}
+
+// Descending depth; gives up (returning 0) after budget moves.
+static int insertionSortDepth(FaceDepth *items, int count, long budget) {
+    for (int i = 1; i < count; i++) {
+        FaceDepth cur = items[i];
+        int j = i;
+        while (j > 0 && items[j - 1].depth < cur.depth) {
+            items[j] = items[j - 1];
+            j--;
+            if (--budget < 0) {
+                items[j] = cur;
+                return 0;
+            }
+        }
+        items[j] = cur;
+    }
+    return 1;
+}
+
+// Float bits mapped so unsigned order is descending float order.
+static Uint32 depthKey(float depth) {
+    Uint32 bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    return ~bits;
+}
+
+static void radixSortDepth(FaceDepth *items, FaceDepth *scratch, int count) {
+    FaceDepth *src = items, *dst = scratch;
+    for (int shift = 0; shift < 32; shift += 8) {
+        int offsets[256] = {0};
+        for (int i = 0; i < count; i++) offsets[(depthKey(src[i].depth) >> shift) & 0xFF]++;
+        int sum = 0;
+        for (int b = 0; b < 256; b++) {
+            int n = offsets[b];
+            offsets[b] = sum;
+            sum += n;
+        }
+        for (int i = 0; i < count; i++) dst[offsets[(depthKey(src[i].depth) >> shift) & 0xFF]++] = src[i];
+        FaceDepth *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    // Four passes: the result is back in items.
+}
+
+void render3dDepthSortRun(Render3DDepthSort *s) {
+    if (!s || s->count == 0) {
+        if (s) s->lastCount = 0;
+        return;
+    }
+
+    // Last run's order first, then whatever is new, in the order added.
+    int n = 0;
+    for (int i = 0; i < s->lastCount; i++) {
+        int idx = s->last[i];
+        if (idx >= s->indexCapacity || s->added[idx] != s->gen || s->placed[idx] == s->gen) continue;
+        s->placed[idx] = s->gen;
+        s->scratch[n++] = (FaceDepth){idx, s->depthOf[idx]};
+    }
+    for (int i = 0; i < s->count; i++) {
+        int idx = s->items[i].index;
+        if (s->placed[idx] == s->gen) continue;
+        s->placed[idx] = s->gen;
+        s->scratch[n++] = s->items[i];
+    }
+    FaceDepth *tmp = s->items;
+    s->items = s->scratch;
+    s->scratch = tmp;
+    s->count = n;
+
+    long budget = (long)n * DEPTH_SORT_INSERTION_BUDGET;
+    s->usedRadix = !insertionSortDepth(s->items, n, budget);
+    if (s->usedRadix) radixSortDepth(s->items, s->scratch, n);
+
+    for (int i = 0; i < n; i++) s->last[i] = s->items[i].index;
+    s->lastCount = n;
+}
+
+void render3dDepthSortFree(Render3DDepthSort *s) {
+    if (!s) return;
+    free(s->items);
+    free(s->scratch);
+    free(s->last);
+    free(s->added);
+    free(s->placed);
+    free(s->depthOf);
+    memset(s, 0, sizeof(*s));
+}
@@ -6,6 +6,30 @@
 
 typedef struct { float x, y, z; } Vec3;
 
+// Index width of the batched output. 16-bit halves index bandwidth and
+// splits batches at 65536 vertices; build with RENDER3D_INDEX32 to lift that.
+#ifdef RENDER3D_INDEX32
+typedef Uint32 Render3DIndex;
+#define RENDER3D_MAX_BATCH_VERTS 0x7FFFFFFF
+#else
+typedef Uint16 Render3DIndex;
+#define RENDER3D_MAX_BATCH_VERTS 0x10000
+#endif
+
+// Row-major 3x4 affine transform: rows are (rotation | translation).
+typedef struct { float m[3][4]; } Mat34;
+
+// Plane as n.p + d >= 0 for points on the inside.
+typedef struct { Vec3 n; float d; } Plane3D;
+
+// Front faces wind clockwise on screen (counter-clockwise seen from
+// above for a +y up, x/z ground plane).
+typedef enum {
+    RENDER3D_CULL_NONE,   // double sided
+    RENDER3D_CULL_BACK,
+    RENDER3D_CULL_FRONT,
+} Render3DCullMode;
+
 typedef struct {
     Vec3 *verts;
     SDL_FPoint *uvs;
@@ -13,6 +37,7 @@ typedef struct {
     const int *indices;
     int indexCount;
     SDL_Texture *texture;
+    Render3DCullMode cullMode;
 } Mesh;
 
 typedef struct {
@@ -22,6 +47,22 @@ typedef struct {
     float fov;
 } Camera3D;
 
+// Per-frame camera constants, rebuilt by render3dSetCamera and shared by
+// every projection, culling and depth computation until the next call.
+typedef struct {
+    Vec3 position;
+    Vec3 forward, right, up;
+    float aspect;
+    float focal;          // 1 / tan(fov / 2)
+    float width, height;  // viewport in pixels
+    float nearPlane, farPlane;
+    float guardBand;      // side clip planes at +-guardBand in NDC
+    // world -> (clip x, clip y, view depth); screen = clip / depth
+    Mat34 viewProj;
+    // left, right, bottom, top, near, far; normalized, in world space
+    Plane3D frustum[6];
+} Render3DView;
+
 typedef struct {
     Mesh mesh;
     Vec3 verts[4];
@@ -30,13 +71,73 @@ typedef struct {
     SDL_Color color;
     Vec3 position;
     Vec3 rotation;
+    // World matrix cache, rebuilt lazily when position/rotation change.
+    Mat34 world;
+    Vec3 worldPosition;
+    Vec3 worldRotation;
+    int worldValid;
+    int worldIdentity;
+    // Local AABB of the mesh and its world-space AABB/sphere, which follow
+    // the world matrix.
+    Vec3 boundsMin, boundsMax;
+    Vec3 worldMin, worldMax;
+    Vec3 boundsCenter;
+    float boundsRadius;
+    // Vertex centroid (local and world) and the largest vertex distance
+    // from it; the depth sort key is the world centroid's view depth.
+    Vec3 centroid;
+    Vec3 worldCentroid;
+    float centroidRadius;
 } MeshInstance;
 
+typedef struct {
+    int visible;
+    int culled;
+    int backfaces;  // triangles rejected by the winding test
+    int occluded;   // instances hidden behind the frame's occluders
+    int unoccluded; // instances that passed the occlusion test
+} Render3DCullStats;
+
+// NEAR clips triangles only against the near plane and leaves the rest to
+// the backend; FULL also clips against far and the guard-banded sides.
+typedef enum {
+    RENDER3D_CLIP_NEAR,
+    RENDER3D_CLIP_FULL,
+} Render3DClipMode;
+
+// SDL draws painter-ordered batches through SDL_RenderGeometry and needs
+// callers to sort back to front; SOFTWARE rasterizes with a depth buffer on
+// worker threads (see raster3d.h), so order only matters for ties.
+typedef enum {
+    RENDER3D_BACKEND_SDL,
+    RENDER3D_BACKEND_SOFTWARE,
+} Render3DBackend;
+
 typedef struct {
     int index;
     float depth;
 } FaceDepth;
 
+// Reusable back-to-front sort for FaceDepth lists that change little from
+// frame to frame. Items are laid out in last run's order first (keyed by
+// index, which must be >= 0), then fixed with an insertion pass; if that
+// takes too many moves it switches to an LSD radix sort on the depth bits.
+// All storage is owned by the context and kept between frames.
+typedef struct {
+    FaceDepth *items;   // sorted result after render3dDepthSortRun
+    int count;
+    int usedRadix;      // last run fell back to the radix sort
+    // private
+    FaceDepth *scratch;
+    int capacity;
+    int *last;          // indices in last run's order
+    int lastCount;
+    Uint32 *added, *placed;  // per-index generation stamps
+    float *depthOf;
+    int indexCapacity;
+    Uint32 gen;
+} Render3DDepthSort;
+
 Vec3 v3(float x, float y, float z);
 Vec3 v3_add(Vec3 a, Vec3 b);
 Vec3 v3_sub(Vec3 a, Vec3 b);
@@ -46,10 +147,75 @@ Vec3 v3_cross(Vec3 a, Vec3 b);
 
 void render3dSetCamera(Camera3D cam);
 Camera3D render3dGetCamera(void);
+const Render3DView *render3dGetView(void);
+void render3dSetFarPlane(float farPlane);
+void render3dSetClipMode(Render3DClipMode mode);
+void render3dSetGuardBand(float guardBand);
+// Depth-ratio tessellation: edges are split (up to 2^maxLevel pieces, max 4)
+// until no piece spans more than maxDepthRatio in view depth.
+void render3dSetSubdivision(int maxLevel, float maxDepthRatio);
+// Darkens vertex colors with view depth: scale / (bias + depth), clamped
+// to [minShade, 1]. scale 0 turns it off (the default).
+void render3dSetDepthShading(float scale, float bias, float minShade);
+// Takes effect at the next render3dBeginFrame (or immediate drawMesh).
+void render3dSetBackend(Render3DBackend backend);
+Render3DBackend render3dGetBackend(void);
+// Faces of large meshes are clipped, tessellated and projected on one
+// thread per CPU, including the calling thread. Output is merged in face
+// order and matches one thread's exactly; only the calling thread touches
+// the renderer. render3dShutdown joins these threads and the software
+// backend's; they start again if anything is drawn after it.
+void render3dShutdown(void);
+// Frame batching: drawMesh calls between these are merged into one
+// SDL_RenderGeometry per run of faces sharing a texture.
+void render3dBeginFrame(SDL_Renderer *renderer);
+void render3dFlush(void);
+void render3dEndFrame(void);
+int render3dGetDrawCalls(void);
+// Per-frame vertex/index arena: reserve up front to avoid growth during play.
+void render3dReserveVertices(int count);
+int render3dGetVertexHighWater(void);
+int render3dGetIndexHighWater(void);
+void render3dSubmitMesh(const Mesh *mesh, Vec3 position, Vec3 rotation, SDL_Color baseColor);
+Mat34 render3dMat34FromTransform(Vec3 position, Vec3 rotation);
+Vec3 render3dMat34Apply(const Mat34 *m, Vec3 v);
+Mat34 render3dMat34Mul(const Mat34 *a, const Mat34 *b);
+void render3dSetInstanceTransform(MeshInstance *inst, Vec3 position, Vec3 rotation);
+// Returns NULL when the instance is already in world space.
+const Mat34 *render3dInstanceWorld(MeshInstance *inst);
+// Recompute bounds after editing an instance's vertices.
+void render3dInstanceUpdateBounds(MeshInstance *inst);
+// Grows the bounds over a local box, for geometry drawn along with the
+// mesh (such as a terrain chunk's walls); a recompute drops it again.
+void render3dInstanceExtendBounds(MeshInstance *inst, Vec3 min, Vec3 max);
+
+// Frustum culling against the current view. render3dInstanceVisible counts
+// into the frame's cull stats (reset by render3dBeginFrame).
+int render3dFrustumTestAABB(Vec3 min, Vec3 max);
+int render3dFrustumTestSphere(Vec3 center, float radius);
+int render3dInstanceVisible(MeshInstance *inst);
+Render3DCullStats render3dGetCullStats(void);
+// Occlusion culling against a hierarchical depth buffer (hiz3d.h) that is
+// cleared by render3dBeginFrame. Add the nearest big faces as occluders
+// first, then test instances before drawing them.
+void render3dAddOccluder(MeshInstance *inst);
+int render3dInstanceOccluded(MeshInstance *inst);
+
 float render3dMeshDepth(const Mesh *mesh, Vec3 position, Vec3 rotation);
+float render3dInstanceDepth(MeshInstance *inst);
+// View depth of count world-space points given as separate x/y/z arrays;
+// a single dot product per point in a loop that vectorizes.
+void render3dDepthKeys(const float *x, const float *y, const float *z, int count, float *out);
 void drawMesh(SDL_Renderer *renderer, const Mesh *mesh, Vec3 position, Vec3 rotation, SDL_Color baseColor);
+void drawMeshInstance(SDL_Renderer *renderer, MeshInstance *inst, SDL_Color baseColor);
 void render3dInitQuadMeshUV(MeshInstance *inst, Vec3 v0, Vec3 v1, Vec3 v2, Vec3 v3p, SDL_Color color, SDL_FPoint uv0, SDL_FPoint uv1, SDL_FPoint uv2, SDL_FPoint uv3);
+// Instance over caller-owned mesh buffers, in world space.
+void render3dInitMeshInstance(MeshInstance *inst, Mesh mesh, SDL_Color color);
 void render3dInitQuadMesh(MeshInstance *inst, Vec3 v0, Vec3 v1, Vec3 v2, Vec3 v3p, SDL_Color color);
 int render3dCompareFaceDepth(const void *a, const void *b);
+void render3dDepthSortBegin(Render3DDepthSort *s);
+void render3dDepthSortAdd(Render3DDepthSort *s, int index, float depth);
+void render3dDepthSortRun(Render3DDepthSort *s);
+void render3dDepthSortFree(Render3DDepthSort *s);
 
 #endif
@@ -4,33 +4,32 @@
 #include "../MENGINE/renderer.h"
 #include "../MENGINE/tick.h"
 #include "../MENGINE/ui.h"
+#include "horizon3d.h"
+#include "level.h"
 #include "render3d.h"
+#include "world.h"
 #include <math.h>
 #include <stdlib.h>
 
 // -------------------------------------------------------------
-// Shared map config (must match level.c)
+// Map config (shared values live in level.h)
 // -------------------------------------------------------------
 
-#define MAP_W 50
-#define MAP_H 50
+// Height samples per side of the generated level.
+static const int LEVEL_SIZE = 50;
 
-static const float TILE_SIZE   = 1.0f;
-static const float WALL_HEIGHT = 0.1f;
+// Open-world mode streams chunks within this distance of the camera.
+static const int WORLD_SEED = 1337;
+static const float WORLD_RADIUS = 96.0f;
 
-// -------------------------------------------------------------
-// Externs from level.c
-// -------------------------------------------------------------
-
-extern MeshInstance faces[MAP_W * MAP_H * 6];
-extern int faceCount;
+// Faces closer than this (view depth) fill the occlusion buffer each frame.
+#define MAX_OCCLUDERS 1024
+static const float OCCLUDER_DEPTH = 16.0f;
 
-extern MeshInstance floorFaces[MAP_W * MAP_H];
-extern int floorCount;
-
-void levelInit(void);
-int   tileHeight(int x, int z);
-float sampleHeightAt(float wx, float wz);
+// LOD nodes split while closer than LOD_RANGE of their own width, or while
+// their height error is more than LOD_ERROR of their distance.
+static const float LOD_RANGE = 1.0f;
+static const float LOD_ERROR = 0.01f;
 
 // -------------------------------------------------------------
 // Camera / physics globals
@@ -52,6 +51,33 @@ static const float MAX_FALL_SPEED = -30.0f;
 static int   isGrounded = 1;     // start on ground
 static int   uiHandlerIndex = -1;
 
+// Open-world mode, and where the camera was in the level before it.
+static int   worldMode = 0;
+static int   worldStarted = 0;
+static Vec3  levelCamPos;
+
+// -------------------------------------------------------------
+// Render state
+// -------------------------------------------------------------
+
+// Visible terrain nodes picked by the LOD, back to front; keeps last
+// frame's order between frames.
+static Render3DDepthSort chunkOrder;
+// Triangles and walls of the chunk nearest the camera, back to front.
+static Render3DDepthSort nearOrder;
+// Sort points of terrain triangles, in each chunk's orders[0] order, and
+// their per-frame depths.
+static float *triCentroid[3];
+static float *triDepth;
+static int   *chunkTriStart;
+// Index buffer for the nearest chunk's sorted triangles.
+static int   *nearIndices;
+// Horizon culling: per chunkOrder entry, 1 when hidden this frame, and
+// what it removed.
+static int   horizonCulling = 1;
+static unsigned char *horizonHidden;
+static int   horizonChunks, horizonFaces;
+
 static void startJump(void) {
     if (isGrounded) {
         camVelY = JUMP_IMPULSE;
@@ -64,6 +90,31 @@ static void jumpButtonPressed(Elem *e) {
     startJump();
 }
 
+static void backendButtonPressed(Elem *e) {
+    (void)e;
+    render3dSetBackend(render3dGetBackend() == RENDER3D_BACKEND_SDL ?
+                       RENDER3D_BACKEND_SOFTWARE : RENDER3D_BACKEND_SDL);
+}
+
+static void horizonButtonPressed(Elem *e) {
+    (void)e;
+    horizonCulling = !horizonCulling;
+}
+
+static void worldButtonPressed(Elem *e) {
+    (void)e;
+    worldMode = !worldMode;
+    if (worldMode) {
+        if (!worldStarted) worldInit(WORLD_SEED, levelGrassTexture());
+        worldStarted = 1;
+        levelCamPos = camPos;
+    } else {
+        camPos = levelCamPos;
+        camVelY = 0.0f;
+    }
+    levelSetStreaming(worldMode);
+}
+
 static void initUi(void) {
     RECT screenArea = {0, 0, WINW, WINH};
     uiHandlerIndex = initUiHandler(screenArea);
@@ -79,17 +130,91 @@ static void initUi(void) {
     Elem *jumpButton = createButton(buttonArea, "Jump", jumpButtonPressed);
     if (jumpButton != NULL) { addElem(handler, jumpButton); }
 
+    RECT backendArea = {150, WINH - 110, 120, 28};
+    Elem *backendButton = createButton(backendArea, "Renderer", backendButtonPressed);
+    if (backendButton != NULL) { addElem(handler, backendButton); }
+
+    RECT horizonArea = {280, WINH - 110, 120, 28};
+    Elem *horizonButton = createButton(horizonArea, "Horizon", horizonButtonPressed);
+    if (horizonButton != NULL) { addElem(handler, horizonButton); }
+
+    RECT worldArea = {410, WINH - 110, 120, 28};
+    Elem *worldButton = createButton(worldArea, "World", worldButtonPressed);
+    if (worldButton != NULL) { addElem(handler, worldButton); }
+
     RECT textboxArea = {WINW - 220, 20, 200, 28};
     Elem *textbox = createTextbox(textboxArea, "Ready to explore!");
     if (textbox != NULL) { addElem(handler, textbox); }
 }
 
+// -------------------------------------------------------------
+// Terrain chunk tables
+// -------------------------------------------------------------
+
+static void buildChunkTables(void) {
+    free(triDepth); free(chunkTriStart); free(nearIndices); free(horizonHidden);
+    for (int k = 0; k < 3; k++) free(triCentroid[k]);
+
+    int triTotal = 0;
+    int maxChunkIndices = 0, maxChunkWalls = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        triTotal += chunks[c].detail.indexCount / 3;
+        if (chunks[c].detail.indexCount > maxChunkIndices) maxChunkIndices = chunks[c].detail.indexCount;
+        if (chunks[c].detailWallCount > maxChunkWalls) maxChunkWalls = chunks[c].detailWallCount;
+    }
+
+    triDepth = malloc((size_t)(maxChunkIndices / 3 + maxChunkWalls + 1) * sizeof(float));
+    chunkTriStart = malloc((size_t)(chunkCount + 1) * sizeof(int));
+    nearIndices = malloc((size_t)(maxChunkIndices > 0 ? maxChunkIndices : 1) * sizeof(int));
+    for (int k = 0; k < 3; k++) triCentroid[k] = malloc((size_t)(triTotal > 0 ? triTotal : 1) * sizeof(float));
+    horizonHidden = malloc((size_t)(terrainNodeCount > 0 ? terrainNodeCount : 1));
+    int ok = triDepth && chunkTriStart && nearIndices && horizonHidden;
+    for (int k = 0; k < 3; k++) ok = ok && triCentroid[k];
+    if (!ok) { chunkCount = 0; terrainRoot = -1; return; }
+
+    int t = 0;
+    for (int c = 0; c < chunkCount; c++) {
+        const Mesh *mesh = &chunks[c].detail;
+        chunkTriStart[c] = t;
+        // Both triangles of a tile sort at its center so they stay
+        // together; split keys let a neighbour's triangle slip in between.
+        for (int begin = 0; begin < mesh->indexCount; begin += 6) {
+            int end = begin + 6;
+            Vec3 mn = mesh->verts[mesh->indices[begin]], mx = mn;
+            for (int i = begin; i < end; i++) {
+                Vec3 p = mesh->verts[mesh->indices[i]];
+                mn = v3(fminf(mn.x, p.x), fminf(mn.y, p.y), fminf(mn.z, p.z));
+                mx = v3(fmaxf(mx.x, p.x), fmaxf(mx.y, p.y), fmaxf(mx.z, p.z));
+            }
+            for (int i = begin; i + 2 < end; i += 3, t++) {
+                triCentroid[0][t] = (mn.x + mx.x) * 0.5f;
+                triCentroid[1][t] = (mn.y + mx.y) * 0.5f;
+                triCentroid[2][t] = (mn.z + mx.z) * 0.5f;
+            }
+        }
+    }
+    chunkTriStart[chunkCount] = t;
+}
+
 // -------------------------------------------------------------
 // Init / tick / render
 // -------------------------------------------------------------
 
 void wolf3dInit(void) {
-    levelInit();
+    levelInit(LEVEL_SIZE, LEVEL_SIZE);
+    render3dReserveVertices(1 << 16);
+    render3dSetClipMode(RENDER3D_CLIP_FULL);
+    render3dSetGuardBand(1.5f);
+
+    // per-vertex distance shading, so shading stays smooth across chunks
+    render3dSetDepthShading(1.2f, 0.6f, 0.25f);
+
+    // Without a GPU the SDL renderer is itself a software rasterizer; the
+    // tile-binned backend spreads that work over all cores instead.
+    SDL_RendererInfo info;
+    if (renderer && SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_SOFTWARE)) {
+        render3dSetBackend(RENDER3D_BACKEND_SOFTWARE);
+    }
 
     // start somewhere near (1.5, 1.5)
     float groundY = sampleHeightAt(1.5f, 1.5f);
@@ -100,6 +225,8 @@ void wolf3dInit(void) {
     isGrounded = 1;
     fovDegrees = fov * 180.0f / (float)M_PI;
 
+    buildChunkTables();
+
     initUi();
 }
 
@@ -170,20 +297,18 @@ void wolf3dTick(double dt) {
     //    - If airborne: can cross anything (if jump reaches)
 // ============================================================
 
-    int curTx = (int)(camPos.x / TILE_SIZE);
-    int curTz = (int)(camPos.z / TILE_SIZE);
+    int curTx = (int)floorf(camPos.x / TILE_SIZE);
+    int curTz = (int)floorf(camPos.z / TILE_SIZE);
     int curH  = tileHeight(curTx, curTz);
 
     Vec3 newPos = camPos;
     newPos.x += move.x;
     newPos.z += move.z;
 
-    int newTx = (int)(newPos.x / TILE_SIZE);
-    int newTz = (int)(newPos.z / TILE_SIZE);
+    int newTx = (int)floorf(newPos.x / TILE_SIZE);
+    int newTz = (int)floorf(newPos.z / TILE_SIZE);
     int newH  = tileHeight(newTx, newTz);
 
-    const int WALL_DIFF_THRESHOLD = 4;
-
     if (isGrounded) {
         // grounded: treat |Δheight| >= 4 as a wall edge
         if (abs(newH - curH) < WALL_DIFF_THRESHOLD) {
@@ -197,6 +322,245 @@ void wolf3dTick(double dt) {
         camPos.x = newPos.x;
         camPos.z = newPos.z;
     }
+
+    // request the chunks around the new position; never waits on them
+    if (worldMode) worldUpdate(camPos, WORLD_RADIUS);
+}
+
+// Draws a chunk's runs in order o, with its walls (indices into walls)
+// between them.
+static void drawChunk(SDL_Renderer *renderer, TerrainChunk *chunk, MeshInstance *walls, int o) {
+    MeshInstance *inst = &chunk->inst;
+    const int *starts = chunk->runStarts[o];
+    int indexCount = inst->mesh.indexCount;
+    int run = 0;
+    for (int w = 0; w <= chunk->wallCount; w++) {
+        int slot = w < chunk->wallCount ? chunk->wallSlots[o][w] : chunk->runCount;
+        if (slot > run) {
+            inst->mesh.indices = chunk->orders[o] + starts[run];
+            inst->mesh.indexCount = starts[slot] - starts[run];
+            drawMeshInstance(renderer, inst, inst->color);
+            run = slot;
+        }
+        if (w == chunk->wallCount) break;
+
+        MeshInstance *wall = &walls[chunk->walls[o][w]];
+        if (!render3dInstanceVisible(wall)) continue;
+        if (render3dInstanceOccluded(wall)) continue;
+        drawMeshInstance(renderer, wall, wall->color);
+    }
+    inst->mesh.indices = chunk->orders[0];
+    inst->mesh.indexCount = indexCount;
+}
+
+// Draws the chunk around the camera from its unmerged tiles and walls,
+// sorted together per triangle, so tiles and walls right in front of the
+// camera overlap correctly.
+static void drawNearestChunk(SDL_Renderer *renderer, int c) {
+    TerrainChunk *chunk = &chunks[c];
+    MeshInstance *inst = &chunk->inst;
+    int triStart = chunkTriStart[c];
+    int triCount = chunkTriStart[c + 1] - triStart;
+    const int *walls = chunk->detailWalls;
+
+    render3dDepthKeys(triCentroid[0] + triStart, triCentroid[1] + triStart, triCentroid[2] + triStart,
+                      triCount, triDepth);
+    render3dDepthSortBegin(&nearOrder);
+    for (int t = 0; t < triCount; t++) render3dDepthSortAdd(&nearOrder, t, triDepth[t]);
+    for (int w = 0; w < chunk->detailWallCount; w++) {
+        MeshInstance *wall = &wallTiles[walls[w]];
+        if (!render3dInstanceVisible(wall)) continue;
+        render3dDepthSortAdd(&nearOrder, triCount + w, render3dInstanceDepth(wall));
+    }
+    render3dDepthSortRun(&nearOrder);
+
+    // runs of triangles between walls go out as one draw of the chunk
+    Mesh merged = inst->mesh;
+    inst->mesh = chunk->detail;
+    const int *src = chunk->detail.indices;
+    int run = 0;
+    for (int i = 0; i <= nearOrder.count; i++) {
+        int item = i < nearOrder.count ? nearOrder.items[i].index : -1;
+        if (item >= 0 && item < triCount) {
+            nearIndices[run * 3 + 0] = src[item * 3 + 0];
+            nearIndices[run * 3 + 1] = src[item * 3 + 1];
+            nearIndices[run * 3 + 2] = src[item * 3 + 2];
+            run++;
+            continue;
+        }
+        if (run > 0) {
+            inst->mesh.indices = nearIndices;
+            inst->mesh.indexCount = run * 3;
+            drawMeshInstance(renderer, inst, inst->color);
+            run = 0;
+        }
+        if (item >= 0) {
+            MeshInstance *wall = &wallTiles[walls[item - triCount]];
+            if (!render3dInstanceOccluded(wall)) drawMeshInstance(renderer, wall, wall->color);
+        }
+    }
+    inst->mesh = merged;
+}
+
+// Walks the LOD quadtree, adding the visible nodes to draw to chunkOrder
+// by ground distance, and tracks the leaf chunk nearest to pos.
+static void selectTerrain(int n, Vec3 pos, int *nearest, float *nearestDist) {
+    const TerrainNode *node = &terrainNodes[n];
+    if (!render3dFrustumTestAABB(node->min, node->max)) return;
+
+    float dx = fmaxf(fmaxf(node->min.x - pos.x, pos.x - node->max.x), 0.0f);
+    float dy = fmaxf(fmaxf(node->min.y - pos.y, pos.y - node->max.y), 0.0f);
+    float dz = fmaxf(fmaxf(node->min.z - pos.z, pos.z - node->max.z), 0.0f);
+    float dist = sqrtf(dx * dx + dy * dy + dz * dz);
+    if (node->level > 0) {
+        float width = (float)(CHUNK_TILES << node->level) * TILE_SIZE;
+        if (dist < width * LOD_RANGE || node->error > dist * LOD_ERROR) {
+            for (int k = 0; k < 4; k++) {
+                if (node->children[k] >= 0) selectTerrain(node->children[k], pos, nearest, nearestDist);
+            }
+            return;
+        }
+    }
+
+    MeshInstance *inst = &node->chunk->inst;
+    if (!render3dInstanceVisible(inst)) return;
+    float ex = inst->boundsCenter.x - pos.x;
+    float ez = inst->boundsCenter.z - pos.z;
+    render3dDepthSortAdd(&chunkOrder, n, sqrtf(ex * ex + ez * ez));
+    if (node->level == 0 && dist < *nearestDist) {
+        *nearestDist = dist;
+        *nearest = n;
+    }
+}
+
+// The loaded level: LOD-selected chunks back to front, floor, horizon and
+// occlusion culling.
+static void drawLevel(SDL_Renderer *renderer, Vec3 renderPos) {
+    // sort visible chunks back-to-front by ground distance, which orders
+    // neighbouring grid cells better than view depth; the software backend
+    // depth-tests, but occluders still go in nearest first
+    int painter = render3dGetBackend() == RENDER3D_BACKEND_SDL;
+    render3dDepthSortBegin(&chunkOrder);
+    int nearest = -1;
+    float nearestDist = INFINITY;
+    if (terrainRoot >= 0) selectTerrain(terrainRoot, renderPos, &nearest, &nearestDist);
+    // Horizon culling assumes an upright camera above the heightfield.
+    float mapW = levelInfo.width * TILE_SIZE, mapH = levelInfo.height * TILE_SIZE;
+    int horizon = horizonCulling && camPitch == 0.0f &&
+                  renderPos.x >= 0.0f && renderPos.x <= mapW &&
+                  renderPos.z >= 0.0f && renderPos.z <= mapH &&
+                  renderPos.y > sampleHeightAt(renderPos.x, renderPos.z);
+    render3dDepthSortRun(&chunkOrder);
+    const FaceDepth *order = chunkOrder.items;
+    int orderCount = chunkOrder.count;
+
+    // Near to far, chunks under the horizon of those in front are hidden;
+    // the rest raise it.
+    horizonChunks = horizonFaces = 0;
+    for (int i = 0; i < orderCount; i++) horizonHidden[i] = 0;
+    if (horizon) {
+        horizon3dBegin(render3dGetView());
+        for (int i = orderCount - 1; i >= 0; i--) {
+            const TerrainNode *node = &terrainNodes[order[i].index];
+            MeshInstance *inst = &node->chunk->inst;
+            if (order[i].index != nearest && horizon3dOccludedAABB(node->min, node->max)) {
+                horizonHidden[i] = 1;
+                horizonChunks++;
+                horizonFaces += inst->mesh.indexCount / 3 + node->chunk->wallCount;
+                continue;
+            }
+            horizon3dAddMesh(&inst->mesh, render3dInstanceWorld(inst));
+        }
+    }
+
+    // nearby chunks and their walls become occluders for everything behind
+    // them, nearest first so the cap keeps the ones that hide the most
+    int occluders = 0;
+    for (int i = orderCount - 1; i >= 0 && occluders < MAX_OCCLUDERS; i--) {
+        if (order[i].depth > OCCLUDER_DEPTH + CHUNK_TILES * TILE_SIZE) break;
+        const TerrainNode *node = &terrainNodes[order[i].index];
+        if (horizonHidden[i] || node->level > 0) continue;
+        TerrainChunk *chunk = node->chunk;
+        render3dAddOccluder(&chunk->inst);
+        occluders++;
+        for (int w = 0; w < chunk->wallCount && occluders < MAX_OCCLUDERS; w++) {
+            MeshInstance *wall = &faces[chunk->walls[0][w]];
+            if (render3dInstanceDepth(wall) > OCCLUDER_DEPTH) continue;
+            render3dAddOccluder(wall);
+            occluders++;
+        }
+    }
+
+    // floor (optional, mostly hidden by terrain)
+    for (int i = 0; i < floorCount; i++) {
+        if (!render3dInstanceVisible(&floorFaces[i])) continue;
+        if (render3dInstanceOccluded(&floorFaces[i])) continue;
+        drawMeshInstance(renderer, &floorFaces[i], floorFaces[i].color);
+    }
+
+    // Chunks far to near. Each draws its tiles in the index order that runs
+    // away from the camera's quadrant, walls slotted in between; the nearest
+    // chunk instead sorts its triangles and walls together.
+    for (int i = 0; i < orderCount; i++) {
+        if (horizonHidden[i]) continue;
+        int n = order[i].index;
+        TerrainChunk *chunk = terrainNodes[n].chunk;
+        MeshInstance *inst = &chunk->inst;
+        if (render3dInstanceOccluded(inst)) continue;
+
+        if (painter && n == nearest) {
+            drawNearestChunk(renderer, (int)(chunk - chunks));
+            continue;
+        }
+
+        int o = 0;
+        if (painter) {
+            Vec3 center = inst->boundsCenter;
+            if (renderPos.x <= center.x) o |= 1;
+            if (renderPos.z <= center.z) o |= 2;
+        }
+        drawChunk(renderer, chunk, faces, o);
+    }
+}
+
+// Streamed world chunks, drawn like the level's leaf chunks. There is no
+// LOD or horizon here, and the nearest chunk keeps its tile order.
+static void drawWorld(SDL_Renderer *renderer, Vec3 renderPos) {
+    int painter = render3dGetBackend() == RENDER3D_BACKEND_SDL;
+    int count;
+    WorldChunk *const *ready = worldChunks(&count);
+    render3dDepthSortBegin(&chunkOrder);
+    for (int i = 0; i < count; i++) {
+        MeshInstance *inst = &ready[i]->terrain.inst;
+        if (!render3dInstanceVisible(inst)) continue;
+        float ex = inst->boundsCenter.x - renderPos.x;
+        float ez = inst->boundsCenter.z - renderPos.z;
+        // keyed by slot, which a chunk keeps while cached, so last frame's
+        // order still holds when chunks come and go
+        render3dDepthSortAdd(&chunkOrder, ready[i]->slot, sqrtf(ex * ex + ez * ez));
+    }
+    render3dDepthSortRun(&chunkOrder);
+    const FaceDepth *order = chunkOrder.items;
+    horizonChunks = horizonFaces = 0;
+
+    int occluders = 0;
+    for (int i = chunkOrder.count - 1; i >= 0 && occluders < MAX_OCCLUDERS; i--) {
+        if (order[i].depth > OCCLUDER_DEPTH + CHUNK_TILES * TILE_SIZE) break;
+        render3dAddOccluder(&worldChunkInSlot(order[i].index)->terrain.inst);
+        occluders++;
+    }
+
+    for (int i = 0; i < chunkOrder.count; i++) {
+        WorldChunk *chunk = worldChunkInSlot(order[i].index);
+        MeshInstance *inst = &chunk->terrain.inst;
+        if (render3dInstanceOccluded(inst)) continue;
+        int o = 0;
+        if (painter) {
+            if (renderPos.x <= inst->boundsCenter.x) o |= 1;
+            if (renderPos.z <= inst->boundsCenter.z) o |= 2;
+        }
+        drawChunk(renderer, &chunk->terrain, chunk->walls, o);
+    }
 }
 
 void wolf3dRender(SDL_Renderer *renderer) {
@@ -207,53 +571,37 @@ void wolf3dRender(SDL_Renderer *renderer) {
 
     Camera3D cam = {renderPos, camYaw, camPitch, fov};
     render3dSetCamera(cam);
+    render3dBeginFrame(renderer);
 
-    // floor (optional, mostly hidden by terrain)
-    for (int i = 0; i < floorCount; i++) {
-        drawMesh(renderer,
-            &floorFaces[i].mesh,
-            floorFaces[i].position,
-            floorFaces[i].rotation,
-            floorFaces[i].color);
-    }
+    if (worldMode) drawWorld(renderer, renderPos);
+    else drawLevel(renderer, renderPos);
 
-    // sort terrain + walls back-to-front
-    FaceDepth order[MAP_W * MAP_H * 6];
-    for (int i = 0; i < faceCount; i++) {
-        order[i].index = i;
-        order[i].depth = render3dMeshDepth(
-            &faces[i].mesh,
-            faces[i].position,
-            faces[i].rotation);
-    }
-    qsort(order, faceCount, sizeof(FaceDepth), render3dCompareFaceDepth);
-
-    // draw with distance shading
-    for (int i = 0; i < faceCount; i++) {
-        int idx = order[i].index;
-        float shade = 1.2f / (0.6f + order[i].depth);
-        if (shade > 1.0f)  shade = 1.0f;
-        if (shade < 0.25f) shade = 0.25f;
-
-        SDL_Color c = faces[idx].color;
-        SDL_Color shaded = {
-            (Uint8)(c.r * shade),
-            (Uint8)(c.g * shade),
-            (Uint8)(c.b * shade),
-            c.a
-        };
-
-        drawMesh(renderer,
-            &faces[idx].mesh,
-            faces[idx].position,
-            faces[idx].rotation,
-            shaded);
-    }
+    render3dEndFrame();
 
     SDL_Color white = {255, 255, 255, 255};
     drawText("default_font", 10, 10, ANCHOR_TOP_L, white,
              "3D Terrain | WASD move, A/D turn, SPACE jump");
     drawText("default_font", 10, 28, ANCHOR_TOP_L, white,
-             "FPS: %d", getFPS());
+             "FPS: %d  draws: %d  %s", getFPS(), render3dGetDrawCalls(),
+             render3dGetBackend() == RENDER3D_BACKEND_SDL ? "SDL" : "software");
+    Render3DCullStats cull = render3dGetCullStats();
+    drawText("default_font", 10, 46, ANCHOR_TOP_L, white,
+             "faces: %d visible, %d culled, %d backfacing tris",
+             cull.visible, cull.culled, cull.backfaces);
+    drawText("default_font", 10, 64, ANCHOR_TOP_L, white,
+             "occlusion: %d hidden, %d drawn", cull.occluded, cull.unoccluded);
+    drawText("default_font", 10, 82, ANCHOR_TOP_L, white,
+             "horizon: %s, %d chunks, %d faces culled",
+             horizonCulling ? "on" : "off", horizonChunks, horizonFaces);
+    if (worldMode) {
+        WorldStats ws = worldGetStats();
+        drawText("default_font", 10, 100, ANCHOR_TOP_L, white,
+                 "world: %d chunks, %d pending, %.1f / %.1f MB, %d threads",
+                 ws.ready, ws.pending, ws.bytes / 1048576.0, ws.budget / 1048576.0, ws.threads);
+    }
 }
 
+void wolf3dShutdown(void) {
+    worldShutdown();
+    render3dShutdown();
+}
@@ -3,9 +3,58 @@
 
 #include <SDL.h>
 #include "../MENGINE/mutil.h"
+#include "render3d.h"
+
+// Terrain is built in CHUNK_TILES x CHUNK_TILES tile chunks sharing one
+// vertex/index buffer, with coplanar tiles along a row merged into runs.
+// Each chunk carries its runs in four orders, far to near for the camera
+// in each quadrant around the chunk: bit 0 set means x descending, bit 1
+// z descending. Run i of order o starts at index runStarts[o][i];
+// runKeys[o][i] is the position of its nearest tile in the tile order.
+// Walls (faces[] indices) are slotted in: walls[o][i] is drawn before
+// run wallSlots[o][i]. detail holds the chunk's tiles unmerged, row by
+// row, with its walls one tile edge each (wallTiles[] indices), for the
+// chunk the camera is in, which is sorted per triangle.
+//
+// LOD chunks (level > 0) use the same layout with cells 1 << level tiles
+// across in place of tiles, one run per cell, plus skirts drawn first.
+#define CHUNK_TILES 8
+
+typedef struct {
+    MeshInstance inst;   // mesh points into the shared terrain buffers
+    int level;
+    int tileX, tileZ;    // first tile
+    int tilesX, tilesZ;  // in cells for LOD chunks
+    int runCount;
+    const int *orders[4];
+    const int *runStarts[4];   // runCount + 1 entries
+    const int *runKeys[4];
+    int wallCount;
+    const int *walls[4];
+    const int *wallSlots[4];
+    Mesh detail;
+    int detailWallCount;
+    const int *detailWalls;
+} TerrainChunk;
+
+// Quadtree over the chunks for distance LOD. Level 0 nodes are the
+// chunks; a level L node is a LOD chunk covering 2^L x 2^L of them.
+// error is how far (world units) its surface strays from the tiles, and
+// min/max bound the tiles and walls under it.
+typedef struct {
+    int level;
+    TerrainChunk *chunk;
+    int parent;
+    int children[4];   // -1 past the map edge
+    float error;
+    Vec3 min, max;
+} TerrainNode;
 
 void wolf3dInit();
 void wolf3dTick(double dt);
 void wolf3dRender(SDL_Renderer *renderer);
+// Stops the world's and the renderer's worker threads, and frees the
+// world's chunks, before SDL goes away.
+void wolf3dShutdown(void);
 
 #endif
@@ -0,0 +1,601 @@
+#include "world.h"
+#include "level.h"
+#include "noisegrid.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define WORLD_SIDE (CHUNK_TILES + 1)
+#define WORLD_TILES (CHUNK_TILES * CHUNK_TILES)
+
+static fnl_state gHills;
+static fnl_state gBumps;
+static SDL_Texture *gGrass = NULL;
+static int gStarted = 0;
+
+// Cache: chunks by coordinates, and the ready ones most recently wanted
+// first. Only the calling thread touches either.
+static WorldChunk *gBuckets[WORLD_HASH_BUCKETS];
+static WorldChunk *gLruHead = NULL, *gLruTail = NULL;
+static WorldChunk *gLastLookup = NULL;
+static size_t gBytes = 0;
+static int gReadyCount = 0;
+static int gInFlight = 0;
+static int gBuiltCount = 0, gEvictedCount = 0;
+static unsigned gFrame = 0;
+
+// Ready chunks by slot, and the slots below gSlotCount left free by
+// evicted ones.
+static WorldChunk **gSlots = NULL;
+static int *gFreeSlots = NULL;
+static int gSlotCount = 0, gFreeSlotCount = 0, gSlotCapacity = 0;
+
+// Ready chunks in range, nearest first, and chunk offsets around the
+// camera's chunk by distance for the current radius.
+static WorldChunk **gInRange = NULL;
+static int gInRangeCount = 0, gWantedCount = 0;
+static int (*gOffsets)[2] = NULL;
+static int gOffsetCount = 0;
+static int gOffsetReach = -1;
+
+// Worker pool: helpers wait on gWake for gQueue; built chunks go back on
+// gDone. All three are guarded by gLock.
+static SDL_Thread *gWorkers[WORLD_MAX_THREADS];
+static int gWorkerCount = 0;
+static SDL_mutex *gLock = NULL;
+static SDL_cond *gWake = NULL;
+static WorldChunk *gQueue[WORLD_QUEUE_MAX];
+static int gQueueCount = 0, gQueueNext = 0;
+static WorldChunk *gDone = NULL;
+static int gQuit = 0;
+// Queued chunks no worker started, taken back by the last collectChunks.
+static WorldChunk *gIdle[WORLD_QUEUE_MAX];
+static int gIdleCount = 0;
+
+static int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static inline int iabs_int(int v) { return v < 0 ? -v : v; }
+
+// -------------------------------------------------------------
+// Generation (any thread)
+// -------------------------------------------------------------
+
+// Rolling hills plus the level's small bumps, in height steps.
+static int heightFrom(float hills, float bumps) {
+    return (int)roundf(hills * 40.0f) + (int)roundf(bumps * 2.0f);
+}
+
+static int genHeight(int x, int z) {
+    return heightFrom(fnlGetNoise2D(&gHills, (float)x, (float)z), fnlGetNoise2D(&gBumps, (float)x, (float)z));
+}
+
+// Same rule as the level: a tile crossed by a cliff is flattened to its
+// lowest corner and the cliff becomes a wall.
+static void tileCorners(const int *heights, int lx, int lz, int h[4]) {
+    int h00 = heights[lz * WORLD_SIDE + lx];
+    int h10 = heights[lz * WORLD_SIDE + lx + 1];
+    int h11 = heights[(lz + 1) * WORLD_SIDE + lx + 1];
+    int h01 = heights[(lz + 1) * WORLD_SIDE + lx];
+    int cliff = iabs_int(h00 - h10) >= WALL_DIFF_THRESHOLD || iabs_int(h10 - h11) >= WALL_DIFF_THRESHOLD ||
+                iabs_int(h11 - h01) >= WALL_DIFF_THRESHOLD || iabs_int(h01 - h00) >= WALL_DIFF_THRESHOLD;
+    if (cliff) {
+        int m = h00;
+        if (h10 < m) m = h10;
+        if (h11 < m) m = h11;
+        if (h01 < m) m = h01;
+        h[0] = h[1] = h[2] = h[3] = m;
+        return;
+    }
+    h[0] = h00;
+    h[1] = h10;
+    h[2] = h11;
+    h[3] = h01;
+}
+
+// Wall between sample (lx, lz) and the next one along x (axis 0) or z
+// (axis 1), as in the level: on that tile edge, facing the lower side.
+typedef struct {
+    int lx, lz, axis;
+    int hA, hB;
+} WorldWall;
+
+static void buildWall(MeshInstance *inst, const WorldWall *w, int x0, int z0) {
+    int diff = w->hB - w->hA;
+    int flip = w->axis == 0 ? diff > 0 : diff < 0;
+    float fx = (x0 + w->lx + (w->axis == 0)) * TILE_SIZE;
+    float fz = (z0 + w->lz + (w->axis == 1)) * TILE_SIZE;
+    float ex = w->axis == 1 ? TILE_SIZE : 0.0f;
+    float ez = w->axis == 0 ? TILE_SIZE : 0.0f;
+    float yLow  = (diff > 0 ? w->hA : w->hB) * WALL_HEIGHT;
+    float yHigh = (diff > 0 ? w->hB : w->hA) * WALL_HEIGHT;
+    SDL_Color col = diff > 0 ? (SDL_Color){220, 220, 240, 255} : (SDL_Color){140, 140, 170, 255};
+
+    Vec3 a = v3(fx,      yLow,  fz);
+    Vec3 b = v3(fx + ex, yLow,  fz + ez);
+    Vec3 c = v3(fx + ex, yHigh, fz + ez);
+    Vec3 d = v3(fx,      yHigh, fz);
+    SDL_FPoint uvA = {0.0f, 0.0f}, uvB = {1.0f, 0.0f}, uvC = {1.0f, 1.0f}, uvD = {0.0f, 1.0f};
+    if (flip) render3dInitQuadMeshUV(inst, a, d, c, b, col, uvA, uvD, uvC, uvB);
+    else      render3dInitQuadMeshUV(inst, a, b, c, d, col, uvA, uvB, uvC, uvD);
+    inst->mesh.cullMode = RENDER3D_CULL_BACK;
+}
+
+// Heights, tiles in the four orders and walls slotted in, all in one
+// block. Returns 0 when out of memory.
+static int buildChunk(WorldChunk *chunk) {
+    int x0 = chunk->cx * CHUNK_TILES, z0 = chunk->cz * CHUNK_TILES;
+    float hills[WORLD_SIDE * WORLD_SIDE], bumps[WORLD_SIDE * WORLD_SIDE];
+    fnlFillNoise2DGrid(&gHills, (float)x0, (float)z0, 1.0f, 1.0f, WORLD_SIDE, WORLD_SIDE, hills);
+    fnlFillNoise2DGrid(&gBumps, (float)x0, (float)z0, 1.0f, 1.0f, WORLD_SIDE, WORLD_SIDE, bumps);
+    int heights[WORLD_SIDE * WORLD_SIDE];
+    for (int i = 0; i < WORLD_SIDE * WORLD_SIDE; i++) heights[i] = heightFrom(hills[i], bumps[i]);
+
+    WorldWall walls[WORLD_TILES * 2];
+    int wallCount = 0;
+    for (int lz = 0; lz < CHUNK_TILES; lz++) {
+        for (int lx = 0; lx < CHUNK_TILES; lx++) {
+            int h = heights[lz * WORLD_SIDE + lx];
+            int hx = heights[lz * WORLD_SIDE + lx + 1];
+            int hz = heights[(lz + 1) * WORLD_SIDE + lx];
+            if (iabs_int(hx - h) >= WALL_DIFF_THRESHOLD) walls[wallCount++] = (WorldWall){lx, lz, 0, h, hx};
+            if (iabs_int(hz - h) >= WALL_DIFF_THRESHOLD) walls[wallCount++] = (WorldWall){lx, lz, 1, h, hz};
+        }
+    }
+
+    // instances first for alignment, then the float and int arrays
+    size_t size = (size_t)wallCount * sizeof(MeshInstance) +
+                  WORLD_TILES * 4 * (sizeof(Vec3) + sizeof(SDL_FPoint)) +
+                  (WORLD_SIDE * WORLD_SIDE + WORLD_TILES * 6 * 4 + (WORLD_TILES + 1) * 8 +
+                   (size_t)wallCount * 8) * sizeof(int);
+    unsigned char *block = malloc(size);
+    if (!block) return 0;
+    MeshInstance *wallInsts = (MeshInstance *)block;
+    Vec3 *verts = (Vec3 *)(wallInsts + wallCount);
+    SDL_FPoint *uvs = (SDL_FPoint *)(verts + WORLD_TILES * 4);
+    int *ints = (int *)(uvs + WORLD_TILES * 4);
+    chunk->heights = ints;
+    ints += WORLD_SIDE * WORLD_SIDE;
+    for (int i = 0; i < WORLD_SIDE * WORLD_SIDE; i++) chunk->heights[i] = heights[i];
+
+    for (int lz = 0; lz < CHUNK_TILES; lz++) {
+        for (int lx = 0; lx < CHUNK_TILES; lx++) {
+            int h[4];
+            tileCorners(heights, lx, lz, h);
+            int v = (lz * CHUNK_TILES + lx) * 4;
+            for (int k = 0; k < 4; k++) {
+                int cx = lx + (k == 1 || k == 2), cz = lz + (k >= 2);
+                verts[v + k] = v3((x0 + cx) * TILE_SIZE, h[k] * WALL_HEIGHT, (z0 + cz) * TILE_SIZE);
+                uvs[v + k] = (SDL_FPoint){(float)cx / (float)CHUNK_TILES, (float)cz / (float)CHUNK_TILES};
+            }
+        }
+    }
+
+    // Tiles far to near for each quadrant, like a level chunk with one run
+    // per tile: row then column, descending along x for bit 0 and z for
+    // bit 1.
+    TerrainChunk *t = &chunk->terrain;
+    *t = (TerrainChunk){0};
+    t->tileX = x0;
+    t->tileZ = z0;
+    t->tilesX = t->tilesZ = CHUNK_TILES;
+    t->runCount = WORLD_TILES;
+    t->wallCount = wallCount;
+    int quad[6] = {0, 1, 2, 0, 2, 3};
+    for (int o = 0; o < 4; o++) {
+        int *order = ints;
+        int *keys = order + WORLD_TILES * 6;
+        int *starts = keys + WORLD_TILES + 1;
+        ints = starts + WORLD_TILES + 1;
+        for (int k = 0; k < WORLD_TILES; k++) {
+            int row = k / CHUNK_TILES, col = k % CHUNK_TILES;
+            int lz = (o & 2) ? CHUNK_TILES - 1 - row : row;
+            int lx = (o & 1) ? CHUNK_TILES - 1 - col : col;
+            int base = (lz * CHUNK_TILES + lx) * 4;
+            for (int i = 0; i < 6; i++) order[k * 6 + i] = base + quad[i];
+            keys[k] = k;
+            starts[k] = k * 6;
+        }
+        keys[WORLD_TILES] = WORLD_TILES;
+        starts[WORLD_TILES] = WORLD_TILES * 6;
+        t->orders[o] = order;
+        t->runKeys[o] = keys;
+        t->runStarts[o] = starts;
+    }
+
+    // A wall goes right between the two tiles it separates: along a row
+    // before the nearer one, across rows before the nearer row.
+    for (int o = 0; o < 4; o++) {
+        int *list = ints;
+        int *slots = list + wallCount;
+        ints = slots + wallCount;
+        for (int w = 0; w < wallCount; w++) {
+            const WorldWall *wall = &walls[w];
+            int row = (o & 2) ? CHUNK_TILES - 1 - wall->lz : wall->lz;
+            int col = (o & 1) ? CHUNK_TILES - 1 - wall->lx : wall->lx;
+            int slot = wall->axis == 0 ? row * CHUNK_TILES + col + ((o & 1) ? 0 : 1)
+                                       : (row + ((o & 2) ? 0 : 1)) * CHUNK_TILES;
+            int j = w;
+            while (j > 0 && slots[j - 1] > slot) {
+                list[j] = list[j - 1];
+                slots[j] = slots[j - 1];
+                j--;
+            }
+            list[j] = w;
+            slots[j] = slot;
+        }
+        t->walls[o] = list;
+        t->wallSlots[o] = slots;
+    }
+    for (int w = 0; w < wallCount; w++) buildWall(&wallInsts[w], &walls[w], x0, z0);
+
+    SDL_Color color = gGrass ? (SDL_Color){255, 255, 255, 255} : (SDL_Color){180, 180, 200, 255};
+    Mesh mesh = {
+        verts, uvs, WORLD_TILES * 4,
+        t->orders[0], WORLD_TILES * 6,
+        gGrass, RENDER3D_CULL_BACK,
+    };
+    render3dInitMeshInstance(&t->inst, mesh, color);
+    // cliff tiles sit at their lowest corner, below the wall tops
+    for (int w = 0; w < wallCount; w++) {
+        render3dInstanceExtendBounds(&t->inst, wallInsts[w].worldMin, wallInsts[w].worldMax);
+    }
+
+    chunk->walls = wallInsts;
+    chunk->storage = block;
+    chunk->bytes = sizeof(WorldChunk) + size;
+    return 1;
+}
+
+// -------------------------------------------------------------
+// Workers
+// -------------------------------------------------------------
+
+// Takes the next queued chunk and hands it back built; 0 when the queue
+// is empty.
+static int runJob(void) {
+    SDL_LockMutex(gLock);
+    WorldChunk *chunk = gQueueNext < gQueueCount ? gQueue[gQueueNext++] : NULL;
+    SDL_UnlockMutex(gLock);
+    if (!chunk) return 0;
+
+    buildChunk(chunk);
+
+    SDL_LockMutex(gLock);
+    chunk->doneNext = gDone;
+    gDone = chunk;
+    SDL_UnlockMutex(gLock);
+    return 1;
+}
+
+static int workerMain(void *data) {
+    (void)data;
+    for (;;) {
+        SDL_LockMutex(gLock);
+        while (!gQuit && gQueueNext >= gQueueCount) SDL_CondWait(gWake, gLock);
+        int quit = gQuit;
+        SDL_UnlockMutex(gLock);
+        if (quit) break;
+        runJob();
+    }
+    return 0;
+}
+
+static int wantedThreads(void) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 0;
+#else
+    // leave a core to the render thread
+    int count = SDL_GetCPUCount() - 1;
+    if (count < 1) count = 1;
+    if (count > WORLD_MAX_THREADS) count = WORLD_MAX_THREADS;
+    return count;
+#endif
+}
+
+static void stopWorkers(void) {
+    if (gLock) {
+        SDL_LockMutex(gLock);
+        gQuit = 1;
+        SDL_CondBroadcast(gWake);
+        SDL_UnlockMutex(gLock);
+    }
+    for (int i = 0; i < gWorkerCount; i++) SDL_WaitThread(gWorkers[i], NULL);
+    gWorkerCount = 0;
+    gQuit = 0;
+}
+
+// Without threads chunks are built on the calling thread, a few per
+// update; SDL's lock calls then do nothing.
+static void startWorkers(void) {
+    if (!gLock) gLock = SDL_CreateMutex();
+    if (!gWake) gWake = SDL_CreateCond();
+    if (!gLock || !gWake) return;
+    int count = wantedThreads();
+    while (gWorkerCount < count) {
+        SDL_Thread *thread = SDL_CreateThread(workerMain, "world", NULL);
+        if (!thread) break;
+        gWorkers[gWorkerCount++] = thread;
+    }
+}
+
+// -------------------------------------------------------------
+// Cache (calling thread)
+// -------------------------------------------------------------
+
+static unsigned hashChunk(int cx, int cz) {
+    return ((unsigned)cx * 73856093u ^ (unsigned)cz * 19349663u) & (WORLD_HASH_BUCKETS - 1);
+}
+
+static WorldChunk *findChunk(int cx, int cz) {
+    for (WorldChunk *c = gBuckets[hashChunk(cx, cz)]; c; c = c->hashNext) {
+        if (c->cx == cx && c->cz == cz) return c;
+    }
+    return NULL;
+}
+
+static void lruUnlink(WorldChunk *c) {
+    if (c->lruPrev) c->lruPrev->lruNext = c->lruNext; else gLruHead = c->lruNext;
+    if (c->lruNext) c->lruNext->lruPrev = c->lruPrev; else gLruTail = c->lruPrev;
+    c->lruPrev = c->lruNext = NULL;
+}
+
+static void lruPushFront(WorldChunk *c) {
+    c->lruPrev = NULL;
+    c->lruNext = gLruHead;
+    if (gLruHead) gLruHead->lruPrev = c; else gLruTail = c;
+    gLruHead = c;
+}
+
+// Gives a chunk becoming ready a slot, a freed one first; 0 when out of
+// memory.
+static int takeSlot(WorldChunk *c) {
+    if (gFreeSlotCount == 0 && gSlotCount == gSlotCapacity) {
+        int newCap = gSlotCapacity > 0 ? gSlotCapacity * 2 : 256;
+        WorldChunk **slots = realloc(gSlots, (size_t)newCap * sizeof(WorldChunk *));
+        if (slots) gSlots = slots;
+        int *freeSlots = realloc(gFreeSlots, (size_t)newCap * sizeof(int));
+        if (freeSlots) gFreeSlots = freeSlots;
+        if (!slots || !freeSlots) return 0;
+        gSlotCapacity = newCap;
+    }
+    c->slot = gFreeSlotCount > 0 ? gFreeSlots[--gFreeSlotCount] : gSlotCount++;
+    gSlots[c->slot] = c;
+    return 1;
+}
+
+// Unlinks and frees a chunk that no worker holds.
+static void dropChunk(WorldChunk *c) {
+    WorldChunk **link = &gBuckets[hashChunk(c->cx, c->cz)];
+    while (*link != c) link = &(*link)->hashNext;
+    *link = c->hashNext;
+    if (c->state == WORLD_CHUNK_READY) {
+        gSlots[c->slot] = NULL;
+        gFreeSlots[gFreeSlotCount++] = c->slot;
+        lruUnlink(c);
+        gBytes -= c->bytes;
+        gReadyCount--;
+    }
+    if (gLastLookup == c) gLastLookup = NULL;
+    free(c->storage);
+    free(c);
+}
+
+// Least recently wanted first, never one wanted this update.
+static void evictTo(size_t target) {
+    while (gBytes > target && gLruTail && gLruTail->frameWanted != gFrame) {
+        dropChunk(gLruTail);
+        gEvictedCount++;
+    }
+}
+
+// Picks up built chunks and takes back the queued ones no worker started
+// as IDLE, for the update to queue again in its new order.
+static void collectChunks(void) {
+    WorldChunk *done;
+    SDL_LockMutex(gLock);
+    done = gDone;
+    gDone = NULL;
+    gIdleCount = 0;
+    while (gQueueNext < gQueueCount) gIdle[gIdleCount++] = gQueue[gQueueNext++];
+    gQueueCount = gQueueNext = 0;
+    SDL_UnlockMutex(gLock);
+
+    for (int i = 0; i < gIdleCount; i++) {
+        gInFlight--;
+        gIdle[i]->state = WORLD_CHUNK_IDLE;
+    }
+    while (done) {
+        WorldChunk *c = done;
+        done = c->doneNext;
+        gInFlight--;
+        if (!c->storage || !takeSlot(c)) {
+            dropChunk(c);
+            continue;
+        }
+        c->state = WORLD_CHUNK_READY;
+        gBytes += c->bytes;
+        gReadyCount++;
+        gBuiltCount++;
+        lruPushFront(c);
+    }
+}
+
+// Chunk offsets within reach chunks of the camera's, nearest first.
+static int compareOffsets(const void *a, const void *b) {
+    const int *pa = a, *pb = b;
+    int da = pa[0] * pa[0] + pa[1] * pa[1], db = pb[0] * pb[0] + pb[1] * pb[1];
+    return da < db ? -1 : da > db ? 1 : 0;
+}
+
+static int buildOffsets(int reach) {
+    int side = reach * 2 + 1;
+    int (*offsets)[2] = realloc(gOffsets, (size_t)side * side * sizeof(*offsets));
+    WorldChunk **inRange = realloc(gInRange, (size_t)side * side * sizeof(*inRange));
+    if (offsets) gOffsets = offsets;
+    if (inRange) gInRange = inRange;
+    if (!offsets || !inRange) return 0;
+    gOffsetCount = 0;
+    for (int dz = -reach; dz <= reach; dz++) {
+        for (int dx = -reach; dx <= reach; dx++) {
+            gOffsets[gOffsetCount][0] = dx;
+            gOffsets[gOffsetCount][1] = dz;
+            gOffsetCount++;
+        }
+    }
+    qsort(gOffsets, (size_t)gOffsetCount, sizeof(*gOffsets), compareOffsets);
+    gOffsetReach = reach;
+    return 1;
+}
+
+void worldUpdate(Vec3 pos, float radius) {
+    if (!gStarted) return;
+    gFrame++;
+    collectChunks();
+
+    float chunkSize = CHUNK_TILES * TILE_SIZE;
+    int reach = (int)ceilf(radius / chunkSize);
+    if (reach != gOffsetReach && !buildOffsets(reach)) return;
+    int pcx = (int)floorf(pos.x / chunkSize);
+    int pcz = (int)floorf(pos.z / chunkSize);
+
+    // Ready chunks in range stay; the missing ones, and idle ones still
+    // wanted, queue nearest first while the budget, after evicting what
+    // isn't wanted, has room.
+    size_t estimate = gReadyCount > 0 ? gBytes / (size_t)gReadyCount : sizeof(WorldChunk) + 16384;
+    WorldChunk *queue[WORLD_QUEUE_MAX];
+    int queueCount = 0;
+    gInRangeCount = gWantedCount = 0;
+    for (int i = 0; i < gOffsetCount; i++) {
+        int cx = pcx + gOffsets[i][0], cz = pcz + gOffsets[i][1];
+        float dx = fmaxf(fmaxf(cx * chunkSize - pos.x, pos.x - (cx + 1) * chunkSize), 0.0f);
+        float dz = fmaxf(fmaxf(cz * chunkSize - pos.z, pos.z - (cz + 1) * chunkSize), 0.0f);
+        if (dx * dx + dz * dz > radius * radius) continue;
+        gWantedCount++;
+
+        WorldChunk *c = findChunk(cx, cz);
+        if (c && c->state != WORLD_CHUNK_IDLE) {
+            c->frameWanted = gFrame;
+            if (c->state == WORLD_CHUNK_READY) {
+                lruUnlink(c);
+                lruPushFront(c);
+                gInRange[gInRangeCount++] = c;
+            }
+            continue;
+        }
+        if (queueCount == WORLD_QUEUE_MAX) continue;
+        size_t reserved = (size_t)(gInFlight + 1) * estimate;
+        if (reserved > WORLD_BUDGET) continue;
+        if (gBytes + reserved > WORLD_BUDGET) evictTo(WORLD_BUDGET - reserved);
+        if (gBytes + reserved > WORLD_BUDGET) continue;
+
+        if (!c) {
+            c = calloc(1, sizeof(WorldChunk));
+            if (!c) continue;
+            c->cx = cx;
+            c->cz = cz;
+            unsigned h = hashChunk(cx, cz);
+            c->hashNext = gBuckets[h];
+            gBuckets[h] = c;
+        }
+        c->state = WORLD_CHUNK_QUEUED;
+        c->frameWanted = gFrame;
+        queue[queueCount++] = c;
+        gInFlight++;
+    }
+    // idle chunks out of range, or with no room left, go
+    for (int i = 0; i < gIdleCount; i++) {
+        if (gIdle[i]->state == WORLD_CHUNK_IDLE) dropChunk(gIdle[i]);
+    }
+    gIdleCount = 0;
+    evictTo(WORLD_BUDGET);
+
+    SDL_LockMutex(gLock);
+    for (int i = 0; i < queueCount; i++) gQueue[i] = queue[i];
+    gQueueCount = queueCount;
+    gQueueNext = 0;
+    if (queueCount > 0) SDL_CondBroadcast(gWake);
+    SDL_UnlockMutex(gLock);
+
+    if (gWorkerCount == 0) {
+        for (int i = 0; i < WORLD_SYNC_BUILDS && runJob(); i++) {}
+    }
+}
+
+WorldChunk *const *worldChunks(int *count) {
+    *count = gInRangeCount;
+    return gInRange;
+}
+
+WorldChunk *worldChunkInSlot(int slot) {
+    return slot >= 0 && slot < gSlotCount ? gSlots[slot] : NULL;
+}
+
+int worldTileHeight(int x, int z) {
+    int cx = floorDiv(x, CHUNK_TILES), cz = floorDiv(z, CHUNK_TILES);
+    WorldChunk *c = gLastLookup;
+    if (!c || c->cx != cx || c->cz != cz) c = findChunk(cx, cz);
+    if (c && c->state == WORLD_CHUNK_READY) {
+        gLastLookup = c;
+        return c->heights[(z - cz * CHUNK_TILES) * WORLD_SIDE + x - cx * CHUNK_TILES];
+    }
+    return genHeight(x, z);
+}
+
+WorldStats worldGetStats(void) {
+    return (WorldStats){
+        gReadyCount, gInFlight, gWantedCount, gBuiltCount, gEvictedCount,
+        gBytes, WORLD_BUDGET, gWorkerCount,
+    };
+}
+
+void worldShutdown(void) {
+    if (!gStarted) return;
+    stopWorkers();
+    collectChunks();
+    for (int b = 0; b < WORLD_HASH_BUCKETS; b++) {
+        while (gBuckets[b]) dropChunk(gBuckets[b]);
+    }
+    gIdleCount = 0;
+    gInRangeCount = gWantedCount = 0;
+    gInFlight = 0;
+
+    free(gSlots);
+    free(gFreeSlots);
+    free(gInRange);
+    free(gOffsets);
+    gSlots = NULL;
+    gFreeSlots = NULL;
+    gInRange = NULL;
+    gOffsets = NULL;
+    gSlotCount = gFreeSlotCount = gSlotCapacity = 0;
+    gOffsetCount = 0;
+    gOffsetReach = -1;
+    if (gWake) SDL_DestroyCond(gWake);
+    if (gLock) SDL_DestroyMutex(gLock);
+    gWake = NULL;
+    gLock = NULL;
+    gStarted = 0;
+}
+
+void worldInit(int seed, SDL_Texture *grass) {
+    worldShutdown();
+
+    gHills = fnlCreateState();
+    gHills.noise_type = FNL_NOISE_OPENSIMPLEX2;
+    gHills.fractal_type = FNL_FRACTAL_FBM;
+    gHills.octaves = 3;
+    gHills.frequency = 0.01f;
+    gHills.seed = seed;
+
+    // the level's bumps
+    gBumps = fnlCreateState();
+    gBumps.noise_type = FNL_NOISE_PERLIN;
+    gBumps.frequency = 0.5f;
+    gBumps.seed = seed + 1;
+
+    gGrass = grass;
+    gBuiltCount = gEvictedCount = 0;
+    startWorkers();
+    gStarted = 1;
+}
@@ -0,0 +1,84 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "wolf3d.h"
+#include <stddef.h>
+
+// Open-world terrain without bounds, streamed in CHUNK_TILES x CHUNK_TILES
+// tile chunks keyed by chunk coordinates (cx, cz). worldUpdate requests the
+// chunks around the camera nearest first; worker threads generate their
+// heights from noise and mesh them, and finished chunks are picked up on
+// the next update. Chunks are kept in an LRU cache and the least recently
+// wanted ones are evicted once the cache is over WORLD_BUDGET bytes, so
+// the main thread never waits on generation: until a chunk is ready it is
+// simply not drawn, and heights under it come straight from the noise.
+//
+// Each chunk is laid out as a leaf TerrainChunk (one run per tile, in the
+// four orders) whose walls index its own wall instances.
+
+#define WORLD_MAX_THREADS 8
+// Chunks handed out per update, nearest first; the rest wait their turn.
+#define WORLD_QUEUE_MAX 64
+// Chunks built per update on the calling thread when there are no workers.
+#define WORLD_SYNC_BUILDS 2
+#define WORLD_HASH_BUCKETS 1024
+// Cache size; chunks nearest the camera are kept over it.
+#define WORLD_BUDGET ((size_t)16 << 20)
+
+// Only the calling thread changes a chunk's state: QUEUED chunks belong to
+// the workers until they come back, with their buffers, as READY. IDLE
+// ones were taken back off the queue before any worker started them, and
+// the next update queues them again or drops them.
+typedef enum {
+    WORLD_CHUNK_QUEUED,
+    WORLD_CHUNK_IDLE,
+    WORLD_CHUNK_READY,
+} WorldChunkState;
+
+typedef struct WorldChunk {
+    int cx, cz;
+    int slot;              // ready chunks: small id, kept until evicted
+    TerrainChunk terrain;
+    MeshInstance *walls;   // terrain.walls index these
+    size_t bytes;          // everything the chunk holds, for the budget
+    // private
+    WorldChunkState state;
+    int *heights;          // (CHUNK_TILES + 1)^2 samples, row by row
+    void *storage;
+    unsigned frameWanted;
+    struct WorldChunk *hashNext;
+    struct WorldChunk *lruPrev, *lruNext;
+    struct WorldChunk *doneNext;
+} WorldChunk;
+
+typedef struct {
+    int ready;       // chunks cached and drawable
+    int pending;     // queued, being built or waiting to be picked up
+    int inRange;     // chunks wanted by the last update
+    int built;       // chunks built so far
+    int evicted;     // chunks dropped by the LRU so far
+    size_t bytes;    // held by ready chunks
+    size_t budget;
+    int threads;     // workers, 0 when building on the calling thread
+} WorldStats;
+
+// (Re)starts the world for a noise seed, dropping all cached chunks. Meshes
+// use the grass texture over each chunk, like the level's.
+void worldInit(int seed, SDL_Texture *grass);
+// Stops the workers and frees every chunk.
+void worldShutdown(void);
+// Once per frame: takes finished chunks, requests those within radius
+// (world units) of pos, and evicts down to the budget.
+void worldUpdate(Vec3 pos, float radius);
+// Ready chunks within the last update's radius, nearest first.
+WorldChunk *const *worldChunks(int *count);
+// The ready chunk holding slot, or NULL. Slots are reused once their
+// chunk is evicted and stay below the most chunks ever ready at once,
+// so they suit per-chunk arrays and keys that last across frames.
+WorldChunk *worldChunkInSlot(int slot);
+// Height steps at tile corner (x, z): from the cached chunk when there is
+// one, else from the noise. Calling thread only.
+int worldTileHeight(int x, int z);
+WorldStats worldGetStats(void);
+
+#endif
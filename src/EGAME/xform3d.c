@@ -0,0 +1,194 @@
+#include "xform3d.h"
+#include <stdlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define XFORM3D_SSE2 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define XFORM3D_WASM 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define XFORM3D_NEON 1
+#endif
+
+int xform3dStreamReserve(VertexStream *s, int count) {
+    if (!s) return 0;
+    if (count <= s->capacity) return 1;
+
+    int newCap = s->capacity > 0 ? s->capacity : 64;
+    while (count > newCap) newCap *= 2;
+
+    // One block, eight float lanes followed by the outcodes.
+    float *block = malloc((size_t)newCap * (8 * sizeof(float) + sizeof(Uint8)));
+    if (!block) return 0;
+
+    free(s->x);
+    s->x = block;
+    s->y = s->x + newCap;
+    s->z = s->y + newCap;
+    s->cx = s->z + newCap;
+    s->cy = s->cx + newCap;
+    s->cw = s->cy + newCap;
+    s->sx = s->cw + newCap;
+    s->sy = s->sx + newCap;
+    s->outcode = (Uint8 *)(s->sy + newCap);
+    s->capacity = newCap;
+    s->count = 0;
+    return 1;
+}
+
+void xform3dStreamLoad(VertexStream *s, const Vec3 *verts, int count) {
+    if (!s || !verts || !xform3dStreamReserve(s, count)) return;
+    for (int i = 0; i < count; i++) {
+        s->x[i] = verts[i].x;
+        s->y[i] = verts[i].y;
+        s->z[i] = verts[i].z;
+    }
+    s->count = count;
+}
+
+void xform3dStreamFree(VertexStream *s) {
+    if (!s) return;
+    free(s->x);
+    *s = (VertexStream){0};
+}
+
+// Every expression below is written as separate multiplies and adds in a
+// fixed order; the SIMD paths mirror it lane for lane.
+static void transformRange(VertexStream *s, const Mat34 *mvp, const Xform3dViewport *vp, int start) {
+    const float (*m)[4] = mvp->m;
+    for (int i = start; i < s->count; i++) {
+        float x = s->x[i], y = s->y[i], z = s->z[i];
+        float cx = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+        float cy = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+        float cw = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+        float nw = 0.0f - cw;
+        float gw = vp->guardBand * cw;
+        float ngw = 0.0f - gw;
+
+        s->cx[i] = cx;
+        s->cy[i] = cy;
+        s->cw[i] = cw;
+        s->sx[i] = (cx / cw * 0.5f + 0.5f) * vp->width;
+        s->sy[i] = (1.0f - (cy / cw * 0.5f + 0.5f)) * vp->height;
+        s->outcode[i] = (Uint8)((cw < vp->nearPlane ? XFORM3D_OUT_NEAR : 0) |
+                                (cx < nw ? XFORM3D_OUT_LEFT : 0) |
+                                (cx > cw ? XFORM3D_OUT_RIGHT : 0) |
+                                (cy < nw ? XFORM3D_OUT_BOTTOM : 0) |
+                                (cy > cw ? XFORM3D_OUT_TOP : 0) |
+                                (cw > vp->farPlane ? XFORM3D_OUT_FAR : 0) |
+                                (cx < ngw || cx > gw || cy < ngw || cy > gw ? XFORM3D_OUT_GUARD : 0));
+    }
+}
+
+void xform3dTransformScalar(VertexStream *s, const Mat34 *mvp, const Xform3dViewport *vp) {
+    if (!s || !mvp || !vp) return;
+    transformRange(s, mvp, vp, 0);
+}
+
+#if defined(XFORM3D_SSE2) || defined(XFORM3D_WASM) || defined(XFORM3D_NEON)
+
+#if defined(XFORM3D_SSE2)
+typedef __m128 F4;
+typedef __m128i M4;
+static inline F4 f4Load(const float *p) { return _mm_loadu_ps(p); }
+static inline void f4Store(float *p, F4 v) { _mm_storeu_ps(p, v); }
+static inline F4 f4Set(float s) { return _mm_set1_ps(s); }
+static inline F4 f4Add(F4 a, F4 b) { return _mm_add_ps(a, b); }
+static inline F4 f4Sub(F4 a, F4 b) { return _mm_sub_ps(a, b); }
+static inline F4 f4Mul(F4 a, F4 b) { return _mm_mul_ps(a, b); }
+static inline F4 f4Div(F4 a, F4 b) { return _mm_div_ps(a, b); }
+static inline M4 m4Lt(F4 a, F4 b, int bit) { return _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(a, b)), _mm_set1_epi32(bit)); }
+static inline M4 m4Or(M4 a, M4 b) { return _mm_or_si128(a, b); }
+static inline void m4Store(int *p, M4 v) { _mm_storeu_si128((__m128i *)p, v); }
+#define XFORM3D_NAME "sse2"
+#elif defined(XFORM3D_WASM)
+typedef v128_t F4;
+typedef v128_t M4;
+static inline F4 f4Load(const float *p) { return wasm_v128_load(p); }
+static inline void f4Store(float *p, F4 v) { wasm_v128_store(p, v); }
+static inline F4 f4Set(float s) { return wasm_f32x4_splat(s); }
+static inline F4 f4Add(F4 a, F4 b) { return wasm_f32x4_add(a, b); }
+static inline F4 f4Sub(F4 a, F4 b) { return wasm_f32x4_sub(a, b); }
+static inline F4 f4Mul(F4 a, F4 b) { return wasm_f32x4_mul(a, b); }
+static inline F4 f4Div(F4 a, F4 b) { return wasm_f32x4_div(a, b); }
+static inline M4 m4Lt(F4 a, F4 b, int bit) { return wasm_v128_and(wasm_f32x4_lt(a, b), wasm_i32x4_splat(bit)); }
+static inline M4 m4Or(M4 a, M4 b) { return wasm_v128_or(a, b); }
+static inline void m4Store(int *p, M4 v) { wasm_v128_store(p, v); }
+#define XFORM3D_NAME "simd128"
+#else
+typedef float32x4_t F4;
+typedef uint32x4_t M4;
+static inline F4 f4Load(const float *p) { return vld1q_f32(p); }
+static inline void f4Store(float *p, F4 v) { vst1q_f32(p, v); }
+static inline F4 f4Set(float s) { return vdupq_n_f32(s); }
+static inline F4 f4Add(F4 a, F4 b) { return vaddq_f32(a, b); }
+static inline F4 f4Sub(F4 a, F4 b) { return vsubq_f32(a, b); }
+static inline F4 f4Mul(F4 a, F4 b) { return vmulq_f32(a, b); }
+static inline F4 f4Div(F4 a, F4 b) { return vdivq_f32(a, b); }
+static inline M4 m4Lt(F4 a, F4 b, int bit) { return vandq_u32(vcltq_f32(a, b), vdupq_n_u32((uint32_t)bit)); }
+static inline M4 m4Or(M4 a, M4 b) { return vorrq_u32(a, b); }
+static inline void m4Store(int *p, M4 v) { vst1q_u32((uint32_t *)p, v); }
+#define XFORM3D_NAME "neon"
+#endif
+
+static inline F4 rowDot(const float row[4], F4 x, F4 y, F4 z) {
+    F4 r = f4Add(f4Mul(f4Set(row[0]), x), f4Mul(f4Set(row[1]), y));
+    r = f4Add(r, f4Mul(f4Set(row[2]), z));
+    return f4Add(r, f4Set(row[3]));
+}
+
+void xform3dTransform(VertexStream *s, const Mat34 *mvp, const Xform3dViewport *vp) {
+    if (!s || !mvp || !vp) return;
+
+    const F4 half = f4Set(0.5f);
+    const F4 one = f4Set(1.0f);
+    const F4 zero = f4Set(0.0f);
+    const F4 width = f4Set(vp->width);
+    const F4 height = f4Set(vp->height);
+    const F4 nearPlane = f4Set(vp->nearPlane);
+    const F4 farPlane = f4Set(vp->farPlane);
+    const F4 guardBand = f4Set(vp->guardBand);
+
+    int i = 0;
+    for (; i + 4 <= s->count; i += 4) {
+        F4 x = f4Load(s->x + i), y = f4Load(s->y + i), z = f4Load(s->z + i);
+        F4 cx = rowDot(mvp->m[0], x, y, z);
+        F4 cy = rowDot(mvp->m[1], x, y, z);
+        F4 cw = rowDot(mvp->m[2], x, y, z);
+        F4 nw = f4Sub(zero, cw);
+        F4 gw = f4Mul(guardBand, cw);
+        F4 ngw = f4Sub(zero, gw);
+
+        f4Store(s->cx + i, cx);
+        f4Store(s->cy + i, cy);
+        f4Store(s->cw + i, cw);
+        f4Store(s->sx + i, f4Mul(f4Add(f4Mul(f4Div(cx, cw), half), half), width));
+        f4Store(s->sy + i, f4Mul(f4Sub(one, f4Add(f4Mul(f4Div(cy, cw), half), half)), height));
+
+        M4 code = m4Or(m4Or(m4Lt(cw, nearPlane, XFORM3D_OUT_NEAR), m4Lt(cx, nw, XFORM3D_OUT_LEFT)),
+                       m4Or(m4Lt(cw, cx, XFORM3D_OUT_RIGHT), m4Lt(cy, nw, XFORM3D_OUT_BOTTOM)));
+        code = m4Or(code, m4Or(m4Lt(cw, cy, XFORM3D_OUT_TOP), m4Lt(farPlane, cw, XFORM3D_OUT_FAR)));
+        M4 guard = m4Or(m4Or(m4Lt(cx, ngw, XFORM3D_OUT_GUARD), m4Lt(gw, cx, XFORM3D_OUT_GUARD)),
+                        m4Or(m4Lt(cy, ngw, XFORM3D_OUT_GUARD), m4Lt(gw, cy, XFORM3D_OUT_GUARD)));
+        code = m4Or(code, guard);
+
+        int codes[4];
+        m4Store(codes, code);
+        for (int k = 0; k < 4; k++) s->outcode[i + k] = (Uint8)codes[k];
+    }
+    transformRange(s, mvp, vp, i);
+}
+
+const char *xform3dBackend(void) { return XFORM3D_NAME; }
+
+#else
+
+void xform3dTransform(VertexStream *s, const Mat34 *mvp, const Xform3dViewport *vp) {
+    xform3dTransformScalar(s, mvp, vp);
+}
+
+const char *xform3dBackend(void) { return "scalar"; }
+
+#endif
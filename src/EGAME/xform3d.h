@@ -0,0 +1,47 @@
+#ifndef XFORM3D_H
+#define XFORM3D_H
+
+#include <SDL.h>
+#include "render3d.h"
+
+// Clip outcodes produced by the vertex kernel.
+enum {
+    XFORM3D_OUT_NEAR   = 1 << 0,
+    XFORM3D_OUT_LEFT   = 1 << 1,
+    XFORM3D_OUT_RIGHT  = 1 << 2,
+    XFORM3D_OUT_BOTTOM = 1 << 3,
+    XFORM3D_OUT_TOP    = 1 << 4,
+    XFORM3D_OUT_FAR    = 1 << 5,
+    XFORM3D_OUT_GUARD  = 1 << 6,  // outside the guard band on any side
+};
+
+// Structure-of-arrays vertex stream. x/y/z are the inputs; the kernel fills
+// clip space (cx, cy, cw), screen space (sx, sy) and outcodes. Screen values
+// are only meaningful for vertices without XFORM3D_OUT_NEAR.
+typedef struct {
+    float *x, *y, *z;
+    float *cx, *cy, *cw;
+    float *sx, *sy;
+    Uint8 *outcode;
+    int count;
+    int capacity;
+} VertexStream;
+
+typedef struct {
+    float nearPlane, farPlane;
+    float guardBand;  // side clip planes at +-guardBand * w
+    float width, height;
+} Xform3dViewport;
+
+// Growing a stream discards its contents.
+int xform3dStreamReserve(VertexStream *s, int count);
+void xform3dStreamLoad(VertexStream *s, const Vec3 *verts, int count);
+void xform3dStreamFree(VertexStream *s);
+
+// Transforms, projects and classifies every vertex of the stream. The SIMD
+// and scalar paths use the same operation order and give identical bits.
+void xform3dTransform(VertexStream *s, const Mat34 *mvp, const Xform3dViewport *vp);
+void xform3dTransformScalar(VertexStream *s, const Mat34 *mvp, const Xform3dViewport *vp);
+const char *xform3dBackend(void);
+
+#endif
@@ -9,7 +9,7 @@
 #include "EGAME/game.h"
 int running=1;
 
-void quit(){ renderFree(); SDL_Quit(); running=0; }
+void quit(){ gameShutdown(); renderFree(); SDL_Quit(); running=0; }
 
 void init(){
    keysInit();